@@ -1,4 +1,4 @@
-// Copyright (c) 2019-2020, Circus.
+﻿// Copyright (c) 2019-2020, Circus.
 //
 // Licensed under the Apache License, Version 2.0 (the "License");
 //
@@ -19,51 +19,546 @@
 namespace circus {
 
 	// String functions.
-	int Contains(const char* str, int n, const char* str1, int n1) {
-		return n == 0 || n1 == 0 ? -1 : (int)circus::text::basic_string(str, n).first(circus::text::basic_string(str1, n1));
+	int ClassifyColumn(const char16_t* str, const int* offsets, int count, BOOL extended, int* flags) {
+		return numerics::classify(str, offsets, count, extended != 0, flags);
 	}
 
-	BOOL Equals(const char* str, int n, const char* str1, int n1) {
-		return n != n1 ? false : circus::text::basic_string(str, n).compare(circus::text::basic_string(str1, n1)) == 0;
+	int Contains(const char16_t* str, int n, const char16_t* str1, int n1) {
+		return n == 0 || n1 == 0 ? -1 : (int)circus::text::basic_string_view(str, n).first(circus::text::basic_string_view(str1, n1));
 	}
 
-	int FirstNotOf(const char* str, int n, const char* str1, int n1) {
-		return (int)circus::text::basic_string(str, n).first_not_of(circus::text::basic_string(str1, n1));
+	int ContainsIgnoreCase(const char16_t* str, int n, const char16_t* str1, int n1) {
+		return n == 0 || n1 == 0 ? -1 : (int)circus::text::basic_string_view(str, n).first_folded(circus::text::basic_string_view(str1, n1));
 	}
 
-	BOOL Hash(const char* str, int n, uint64_t& hash) {
+	int EditDistance(const char16_t* str, int n, const char16_t* str1, int n1, int k, BOOL fold) {
+
+		// The shorter string is the query so that it fits in fewer words.
+		if (n < n1) {
+			std::swap(str, str1);
+			std::swap(n, n1);
+		}
+		return circus::text::fuzzy(str1, n1, fold != 0).distance(circus::text::basic_string_view(str, n), k);
+	}
+
+	BOOL Equals(const char16_t* str, int n, const char16_t* str1, int n1) {
+		return n != n1 ? false : circus::text::basic_string_view(str, n).compare(circus::text::basic_string_view(str1, n1)) == 0;
+	}
+
+	BOOL EqualsIgnoreCase(const char16_t* str, int n, const char16_t* str1, int n1) {
+		return circus::text::basic_string_view(str, n).equals_folded(circus::text::basic_string_view(str1, n1));
+	}
+
+	int FindAll(const char16_t* str, int n, const char16_t* str1, int n1, BOOL fold, BOOL overlapping, int* offsets, int cap) {
+		int i = 0;
+		return (int)circus::text::basic_string_view(str, n).find_all(circus::text::basic_string_view(str1, n1), fold != 0, overlapping != 0, [&](size_t offset) {
+			if (i < cap) {
+				offsets[i++] = (int)offset;
+			}
+		});
+	}
+
+	int FirstNotOf(const char16_t* str, int n, const char16_t* str1, int n1) {
+		return (int)circus::text::basic_string_view(str, n).first_not_of(circus::text::basic_string_view(str1, n1));
+	}
+
+	int FormatDouble(double value, char16_t* str, int n) {
+		int offsets[2];
+		return numerics::format(&value, 1, str, n, offsets) == 1 ? offsets[1] : 0;
+	}
+
+	int FormatDoubleBatch(const double* values, int count, char16_t* str, int n, int* offsets) {
+		return (int)numerics::format(values, count, str, n, offsets);
+	}
+
+	int FormatInt64(int64_t value, char16_t* str, int n) {
+		int offsets[2];
+		return numerics::format(&value, 1, str, n, offsets) == 1 ? offsets[1] : 0;
+	}
+
+	int FormatInt64Batch(const int64_t* values, int count, char16_t* str, int n, int* offsets) {
+		return (int)numerics::format(values, count, str, n, offsets);
+	}
+
+	int FuzzyMatch(const char16_t* str, const int* offsets, int count, const char16_t* str1, int n1, int k, BOOL fold, int* indices, int* distances, int top) {
+		if (count <= 0 || top <= 0) {
+			return 0;
+		}
+		return (int)circus::text::fuzzy(str1, n1, fold != 0).match(str, offsets, count, k, indices, distances, top);
+	}
+
+	int FuzzyScore(const char16_t* str, int n, const char16_t* str1, int n1, BOOL fold) {
+		return circus::text::fuzzy(str1, n1, fold != 0).score(circus::text::basic_string_view(str, n));
+	}
+
+	int FuzzySearch(const char16_t* str, int n, const char16_t* str1, int n1, int k, BOOL fold) {
+		return circus::text::fuzzy(str1, n1, fold != 0).search(circus::text::basic_string_view(str, n), k);
+	}
+
+	BOOL Hash(const char16_t* str, int n, uint64_t& hash) {
+		if (n == 0) {
+			return false;
+		}
+		hash = circus::text::basic_string_view(str, n).hash();
+		return true;
+	}
+
+	void HashBatch(const char16_t* str, const int* offsets, int count, uint64_t* hashes) {
+		farmhash::hash64(str, offsets, count, hashes);
+	}
+
+	void HashBatchLocal(const char16_t* str, const int* offsets, int count, uint64_t* hashes) {
+		farmhash::hash64_local(str, offsets, count, farmhash::seed, hashes);
+	}
+
+	void HashBatchWithSeed(const char16_t* str, const int* offsets, int count, uint64_t seed, uint64_t* hashes) {
+		farmhash::hash64(str, offsets, count, seed, hashes);
+	}
+
+	BOOL HashIgnoreCase(const char16_t* str, int n, uint64_t& hash) {
 		if (n == 0) {
 			return false;
 		}
-		hash = circus::text::basic_string(str, n).hash();
+		hash = circus::text::basic_string_view(str, n).hash_folded();
 		return true;
 	}
 
-	BOOL IsNumeric(const char* str, int n, BOOL& s, BOOL& d) {
-		return n == 0 ? false : numerics::is(circus::text::basic_string(str, n), s, d);
+	int HashKernel() {
+		return (int)farmhash::detail::kernel;
+	}
+
+	BOOL HashLocal(const char16_t* str, int n, uint64_t& hash) {
+		if (n == 0) {
+			return false;
+		}
+		hash = farmhash::hash64_local(str, n, farmhash::seed);
+		return true;
+	}
+
+	uint64_t HashSeed() {
+		return farmhash::seed;
+	}
+
+	BOOL HashWithSeed(const char16_t* str, int n, uint64_t seed, uint64_t& hash) {
+		if (n == 0) {
+			return false;
+		}
+		hash = farmhash::hash64(str, n, seed);
+		return true;
+	}
+
+	BOOL HashWithSeeds(const char16_t* str, int n, uint64_t seed0, uint64_t seed1, uint64_t& hash) {
+		if (n == 0) {
+			return false;
+		}
+		hash = farmhash::hash64(str, n, seed0, seed1);
+		return true;
+	}
+
+	BOOL IsNumeric(const char16_t* str, int n, BOOL& s, BOOL& d) {
+		return n == 0 ? false : numerics::is(circus::text::basic_string_view(str, n), s, d);
+	}
+
+	int Last(const char16_t* str, int n, const char16_t* str1, int n1) {
+		return n == 0 || n1 == 0 ? -1 : (int)circus::text::basic_string_view(str, n).last(circus::text::basic_string_view(str1, n1));
+	}
+
+	int LastNotOf(const char16_t* str, int n, const char16_t* str1, int n1) {
+		return (int)circus::text::basic_string_view(str, n).last_not_of(circus::text::basic_string_view(str1, n1));
+	}
+
+	BOOL ParseNumber(const char16_t* str, int n, int64_t& integer, double& real, int& flags) {
+		return numerics::parse(str, n, integer, real, flags);
+	}
+
+	BOOL Trim(const char16_t* str, int n, const char16_t* str1, int n1, int& start, int& length) {
+		const circus::text::char_set set(str1, n1);
+		auto const i = set.first_not_of(str, n);
+		if (i == circus::text::char_set::npos) {
+			start = length = 0;
+			return false;
+		}
+		start = (int)i;
+		length = (int)(set.last_not_of(str, n) - i + 1);
+		return true;
+	}
+
+	// Searcher functions.
+	void* CreateSearcher(const char16_t* str, int n) {
+		return n == 0 ? nullptr : new (std::nothrow) circus::text::searcher(str, n);
+	}
+
+	void DestroySearcher(void* searcher) {
+		delete static_cast<circus::text::searcher*>(searcher);
+	}
+
+	int SearchWith(void* searcher, const char16_t* str, int n, BOOL fold) {
+		if (searcher == nullptr || n == 0) {
+			return -1;
+		}
+		auto const s = static_cast<const circus::text::searcher*>(searcher);
+		const circus::text::basic_string_view view(str, n);
+		return (int)(fold ? s->find_folded(view) : s->find(view));
+	}
+
+	// Matcher functions.
+	void* CreateMatcher(const char16_t* str, const int* offsets, int count) {
+		return count <= 0 ? nullptr : new (std::nothrow) circus::text::aho_corasick(str, offsets, count);
+	}
+
+	void DestroyMatcher(void* matcher) {
+		delete static_cast<circus::text::aho_corasick*>(matcher);
+	}
+
+	int MatchAll(void* matcher, const char16_t* str, int n, int* matches, int cap) {
+		if (matcher == nullptr || n == 0) {
+			return 0;
+		}
+		return (int)static_cast<const circus::text::aho_corasick*>(matcher)->match(circus::text::basic_string_view(str, n), matches, cap < 0 ? 0 : cap);
+	}
+
+	// String map functions.
+	void* CreateStringMap(int capacity) {
+		return new (std::nothrow) circus::text::string_map(capacity < 0 ? 0 : capacity);
+	}
+
+	void DestroyStringMap(void* map) {
+		delete static_cast<circus::text::string_map*>(map);
+	}
+
+	BOOL StringMapAdd(void* map, const char16_t* str, int n, int64_t value, BOOL update) {
+		if (map == nullptr) {
+			return false;
+		}
+		return static_cast<circus::text::string_map*>(map)->insert(circus::text::basic_string_view(str, n), value, update != 0);
+	}
+
+	void StringMapClear(void* map) {
+		if (map == nullptr) {
+			return;
+		}
+		static_cast<circus::text::string_map*>(map)->clear();
+	}
+
+	int StringMapCount(void* map) {
+		if (map == nullptr) {
+			return 0;
+		}
+		return (int)static_cast<circus::text::string_map*>(map)->size();
+	}
+
+	BOOL StringMapGet(void* map, const char16_t* str, int n, int64_t& value) {
+		if (map == nullptr) {
+			return false;
+		}
+		return static_cast<circus::text::string_map*>(map)->find(circus::text::basic_string_view(str, n), value);
+	}
+
+	int StringMapNext(void* map, int i, const char16_t*& str, int& n, int64_t& value) {
+		if (map == nullptr) {
+			return -1;
+		}
+		auto const m = static_cast<circus::text::string_map*>(map);
+		auto const r = m->next(i);
+		if (r == circus::text::string_map::npos) {
+			return -1;
+		}
+		auto const key = m->key(r);
+		str = key.data();
+		n = (int)key.size();
+		value = m->value(r);
+		return (int)r;
+	}
+
+	BOOL StringMapRemove(void* map, const char16_t* str, int n) {
+		if (map == nullptr) {
+			return false;
+		}
+		return static_cast<circus::text::string_map*>(map)->remove(circus::text::basic_string_view(str, n));
+	}
+
+	void StringMapReserve(void* map, int n) {
+		if (map == nullptr) {
+			return;
+		}
+		static_cast<circus::text::string_map*>(map)->reserve(n < 0 ? 0 : n);
 	}
 
-	int Last(const char* str, int n, const char* str1, int n1) {
-		return n == 0 || n1 == 0 ? -1 : (int)circus::text::basic_string(str, n).last(circus::text::basic_string(str1, n1));
+	// Tokenizer functions.
+	void* CreateTokenizer(const char16_t* str, int n, const char16_t* str1, int n1, char16_t quote, char16_t escape) {
+		return new (std::nothrow) circus::text::tokenizer(str, n, str1, n1, quote, escape);
 	}
 
-	int LastNotOf(const char* str, int n, const char* str1, int n1) {
-		return (int)circus::text::basic_string(str, n).last_not_of(circus::text::basic_string(str1, n1));
+	void DestroyTokenizer(void* tokenizer) {
+		delete static_cast<circus::text::tokenizer*>(tokenizer);
+	}
+
+	int Tokenize(void* tokenizer, const char16_t* str, int n, BOOL last, int* spans, int cap, int& consumed) {
+		if (tokenizer == nullptr || n < 0) {
+			consumed = 0;
+			return 0;
+		}
+		size_t r = 0;
+		auto const count = static_cast<const circus::text::tokenizer*>(tokenizer)->next(circus::text::basic_string_view(str, n), last != 0, spans, cap < 0 ? 0 : cap, r);
+		consumed = (int)r;
+		return (int)count;
+	}
+
+	// File functions.
+	int64_t SearchFile(const char16_t* path, const char16_t* str, int n, circus::text::file_search_callback callback, void* state) {
+		if (n == 0) {
+			return 0;
+		}
+		return circus::text::search_file(path, circus::text::basic_string_view(str, n), callback, state);
+	}
+
+	// Line index functions.
+	void* CreateFileLineIndex(const char16_t* path) {
+		circus::text::detail::mapped_file file(path);
+		if (!file.opened() || file.size() > UINT32_MAX) {
+			return nullptr;
+		}
+		auto const index = new (std::nothrow) circus::text::line_index();
+		if (index != nullptr) {
+			auto const p = file.data();
+			if (file.size() >= 2 && (uint8_t)p[0] == 0xff && (uint8_t)p[1] == 0xfe) {
+				index->assign(reinterpret_cast<const char16_t*>(p), file.size() / 2, 1);
+			}
+			else {
+				index->assign(p, file.size());
+			}
+		}
+		return index;
+	}
+
+	void* CreateLineIndex(const char16_t* str, int n) {
+		auto const index = new (std::nothrow) circus::text::line_index();
+		if (index != nullptr) {
+			index->assign(str, n < 0 ? 0 : n);
+		}
+		return index;
+	}
+
+	void DestroyLineIndex(void* index) {
+		delete static_cast<circus::text::line_index*>(index);
+	}
+
+	int LineIndexCount(void* index) {
+		if (index == nullptr) {
+			return 0;
+		}
+		return (int)static_cast<const circus::text::line_index*>(index)->count();
+	}
+
+	int LineIndexFind(void* index, int64_t offset) {
+		if (index == nullptr) {
+			return -1;
+		}
+		return offset < 0 ? -1 : (int)static_cast<const circus::text::line_index*>(index)->find((size_t)offset);
+	}
+
+	int64_t LineIndexStart(void* index, int line) {
+		if (index == nullptr) {
+			return -1;
+		}
+		auto const i = static_cast<const circus::text::line_index*>(index);
+		return line < 0 || (size_t)line >= i->count() ? -1 : (int64_t)i->start(line);
+	}
+
+	BOOL LineIndexUpdate(void* index, const char16_t* str, int n, int pos, int removed, int inserted) {
+		if (index == nullptr) {
+			return false;
+		}
+		auto const i = static_cast<circus::text::line_index*>(index);
+		if (!i->editable() || pos < 0 || removed < 0 || inserted < 0) {
+			return false;
+		}
+
+		// The removed units must be in the indexed text, and the edited text
+		// must be the indexed one with the range replaced.
+		auto const size = (int64_t)i->size();
+		if (pos > size || removed > size - pos || n != size - removed + inserted) {
+			return false;
+		}
+		i->update(str, n, pos, removed, inserted);
+		return true;
+	}
+
+	// N-gram index functions.
+	void* CreateNgramIndex(BOOL fold) {
+		return new (std::nothrow) circus::text::ngram_index(fold != 0);
+	}
+
+	void DestroyNgramIndex(void* index) {
+		delete static_cast<circus::text::ngram_index*>(index);
+	}
+
+	BOOL NgramIndexAdd(void* index, int64_t id, const char16_t* str, int n) {
+		if (index == nullptr) {
+			return false;
+		}
+		return static_cast<circus::text::ngram_index*>(index)->insert(id, circus::text::basic_string_view(str, n));
+	}
+
+	void NgramIndexAddBatch(void* index, const int64_t* ids, const char16_t* str, const int* offsets, int count) {
+		if (index == nullptr) {
+			return;
+		}
+		auto const i = static_cast<circus::text::ngram_index*>(index);
+		for (int k = 0; k < count; ++k) {
+			i->insert(ids[k], circus::text::basic_string_view(str + offsets[k], offsets[k + 1] - offsets[k]));
+		}
+	}
+
+	void NgramIndexClear(void* index) {
+		if (index == nullptr) {
+			return;
+		}
+		static_cast<circus::text::ngram_index*>(index)->clear();
+	}
+
+	int NgramIndexCount(void* index) {
+		if (index == nullptr) {
+			return 0;
+		}
+		return (int)static_cast<circus::text::ngram_index*>(index)->size();
+	}
+
+	int NgramIndexFind(void* index, const char16_t* str, int n, int64_t* ids, int cap) {
+		if (index == nullptr) {
+			return 0;
+		}
+		return (int)static_cast<const circus::text::ngram_index*>(index)->find(circus::text::basic_string_view(str, n), ids, cap < 0 ? 0 : cap);
+	}
+
+	BOOL NgramIndexRemove(void* index, int64_t id) {
+		if (index == nullptr) {
+			return false;
+		}
+		return static_cast<circus::text::ngram_index*>(index)->remove(id);
+	}
+
+	// Intern pool functions.
+	void* CreateInternPool() {
+		return new (std::nothrow) circus::text::intern_pool();
+	}
+
+	void DestroyInternPool(void* pool) {
+		delete static_cast<circus::text::intern_pool*>(pool);
+	}
+
+	int Intern(void* pool, const char16_t* str, int n) {
+		if (pool == nullptr) {
+			return -1;
+		}
+		return (int)static_cast<circus::text::intern_pool*>(pool)->intern(circus::text::basic_string_view(str, n));
+	}
+
+	BOOL InternBatch(void* pool, const char16_t* str, const int* offsets, int count, int* ids) {
+		if (pool == nullptr) {
+			return false;
+		}
+		auto const p = static_cast<circus::text::intern_pool*>(pool);
+		for (int i = 0; i < count; ++i) {
+			ids[i] = (int)p->intern(circus::text::basic_string_view(str + offsets[i], offsets[i + 1] - offsets[i]));
+			if (ids[i] < 0) {
+				return false;
+			}
+		}
+		return true;
+	}
+
+	int InternPoolCount(void* pool) {
+		if (pool == nullptr) {
+			return 0;
+		}
+		return (int)static_cast<const circus::text::intern_pool*>(pool)->count();
+	}
+
+	int InternPoolFind(void* pool, const char16_t* str, int n) {
+		if (pool == nullptr) {
+			return -1;
+		}
+		return (int)static_cast<const circus::text::intern_pool*>(pool)->find(circus::text::basic_string_view(str, n));
+	}
+
+	BOOL InternPoolGet(void* pool, int id, const char16_t*& str, int& n, uint64_t& hash) {
+		if (pool == nullptr) {
+			return false;
+		}
+		auto const p = static_cast<const circus::text::intern_pool*>(pool);
+		if (id < 0 || (size_t)id >= p->count()) {
+			return false;
+		}
+		str = p->data(id);
+		n = (int)p->size(id);
+		hash = p->hash(id);
+		return true;
 	}
 
 	// Numeric functions.
+	int BucketIndex(uint64_t hash, int slot) {
+		auto const prime = ladder::prime(slot);
+		return prime != 0 && prime <= INT32_MAX ? (int)ladder::index(hash, slot) : -1;
+	}
+
+	BOOL BucketIndexBatch(const uint64_t* hashes, int count, int slot, int* indices) {
+		auto const prime = ladder::prime(slot);
+		if (prime == 0 || prime > INT32_MAX) {
+			return false;
+		}
+		ladder::index(hashes, count, slot, indices);
+		return true;
+	}
+
+	int64_t CountPrimes(int64_t lo, int64_t hi) {
+		return prime::count(lo, hi);
+	}
+
 	BOOL IsPrime(int i) {
 		return prime::is(i);
 	}
 
+	BOOL IsPrime64(int64_t i) {
+		return prime::is(i);
+	}
+
+	int64_t LadderPrime(int slot) {
+		return ladder::prime(slot);
+	}
+
+	int LadderSlot(int64_t size) {
+		return ladder::slot(size);
+	}
+
 	int NextPrime(int i) {
 		return prime::next(i, 1);
 	}
 
+	int64_t NextPrime64(int64_t i) {
+		return prime::next(i, 1);
+	}
+
 	int PreviousPrime(int i) {
 		return prime::next(i, -1);
 	}
 
+	int64_t PreviousPrime64(int64_t i) {
+		return prime::next(i, -1);
+	}
+
+	int PrimeBound() {
+		return prime::bound();
+	}
+
+	int64_t PrimesInRange(int64_t lo, int64_t hi, int64_t* primes, int64_t capacity) {
+		return prime::range(lo, hi, primes, capacity);
+	}
+
+	BOOL SetPrimeBound(int i) {
+		return prime::reserve(i);
+	}
+
 	// Environment functions.
 	BOOL MonitorSize(int f, double& w, double& h) {
 		return environment::monitor::Size(f, w, h);
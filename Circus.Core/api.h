@@ -50,29 +50,132 @@
 #define EXPORT_TO_API __declspec(dllexport)
 #endif
 
+#include <new>
 #include <stdint.h>
 #include <windef.h>
 
 #include "environment/monitor.h"
+#include "hash/ladder.h"
 #include "hash/prime.h"
-#include "text/basic_string.h"
+#include "text/aho_corasick.h"
+#include "text/basic_string_view.h"
+#include "text/char_set.h"
+#include "text/file_search.h"
+#include "text/fuzzy.h"
+#include "text/intern_pool.h"
+#include "text/line_index.h"
+#include "text/ngram_index.h"
 #include "text/numerics.h"
+#include "text/searcher.h"
+#include "text/string_map.h"
+#include "text/tokenizer.h"
 
 namespace circus {
 
 	// String functions.
-	extern "C" EXPORT_TO_API int Contains(const char* str, int n, const char* str1, int n1);
-	extern "C" EXPORT_TO_API BOOL Equals(const char* str, int n, const char* str1, int n1);
-	extern "C" EXPORT_TO_API int FirstNotOf(const char* str, int n, const char* str1, int n1);
-	extern "C" EXPORT_TO_API BOOL Hash(const char* str, int n, uint64_t& hash);
-	extern "C" EXPORT_TO_API BOOL IsNumeric(const char* str, int n, BOOL& s, BOOL& d);
-	extern "C" EXPORT_TO_API int Last(const char* str, int n, const char* str1, int n1);
-	extern "C" EXPORT_TO_API int LastNotOf(const char* str, int n, const char* str1, int n1);
+	extern "C" EXPORT_TO_API int ClassifyColumn(const char16_t* str, const int* offsets, int count, BOOL extended, int* flags);
+	extern "C" EXPORT_TO_API int Contains(const char16_t* str, int n, const char16_t* str1, int n1);
+	extern "C" EXPORT_TO_API int ContainsIgnoreCase(const char16_t* str, int n, const char16_t* str1, int n1);
+	extern "C" EXPORT_TO_API int EditDistance(const char16_t* str, int n, const char16_t* str1, int n1, int k, BOOL fold);
+	extern "C" EXPORT_TO_API BOOL Equals(const char16_t* str, int n, const char16_t* str1, int n1);
+	extern "C" EXPORT_TO_API BOOL EqualsIgnoreCase(const char16_t* str, int n, const char16_t* str1, int n1);
+	extern "C" EXPORT_TO_API int FindAll(const char16_t* str, int n, const char16_t* str1, int n1, BOOL fold, BOOL overlapping, int* offsets, int cap);
+	extern "C" EXPORT_TO_API int FirstNotOf(const char16_t* str, int n, const char16_t* str1, int n1);
+	extern "C" EXPORT_TO_API int FormatDouble(double value, char16_t* str, int n);
+	extern "C" EXPORT_TO_API int FormatDoubleBatch(const double* values, int count, char16_t* str, int n, int* offsets);
+	extern "C" EXPORT_TO_API int FormatInt64(int64_t value, char16_t* str, int n);
+	extern "C" EXPORT_TO_API int FormatInt64Batch(const int64_t* values, int count, char16_t* str, int n, int* offsets);
+	extern "C" EXPORT_TO_API int FuzzyMatch(const char16_t* str, const int* offsets, int count, const char16_t* str1, int n1, int k, BOOL fold, int* indices, int* distances, int top);
+	extern "C" EXPORT_TO_API int FuzzyScore(const char16_t* str, int n, const char16_t* str1, int n1, BOOL fold);
+	extern "C" EXPORT_TO_API int FuzzySearch(const char16_t* str, int n, const char16_t* str1, int n1, int k, BOOL fold);
+	extern "C" EXPORT_TO_API BOOL Hash(const char16_t* str, int n, uint64_t& hash);
+	extern "C" EXPORT_TO_API void HashBatch(const char16_t* str, const int* offsets, int count, uint64_t* hashes);
+	extern "C" EXPORT_TO_API void HashBatchLocal(const char16_t* str, const int* offsets, int count, uint64_t* hashes);
+	extern "C" EXPORT_TO_API void HashBatchWithSeed(const char16_t* str, const int* offsets, int count, uint64_t seed, uint64_t* hashes);
+	extern "C" EXPORT_TO_API BOOL HashIgnoreCase(const char16_t* str, int n, uint64_t& hash);
+	extern "C" EXPORT_TO_API int HashKernel();
+	extern "C" EXPORT_TO_API BOOL HashLocal(const char16_t* str, int n, uint64_t& hash);
+	extern "C" EXPORT_TO_API uint64_t HashSeed();
+	extern "C" EXPORT_TO_API BOOL HashWithSeed(const char16_t* str, int n, uint64_t seed, uint64_t& hash);
+	extern "C" EXPORT_TO_API BOOL HashWithSeeds(const char16_t* str, int n, uint64_t seed0, uint64_t seed1, uint64_t& hash);
+	extern "C" EXPORT_TO_API BOOL IsNumeric(const char16_t* str, int n, BOOL& s, BOOL& d);
+	extern "C" EXPORT_TO_API int Last(const char16_t* str, int n, const char16_t* str1, int n1);
+	extern "C" EXPORT_TO_API int LastNotOf(const char16_t* str, int n, const char16_t* str1, int n1);
+	extern "C" EXPORT_TO_API BOOL ParseNumber(const char16_t* str, int n, int64_t& integer, double& real, int& flags);
+	extern "C" EXPORT_TO_API BOOL Trim(const char16_t* str, int n, const char16_t* str1, int n1, int& start, int& length);
+
+	// Searcher functions.
+	extern "C" EXPORT_TO_API void* CreateSearcher(const char16_t* str, int n);
+	extern "C" EXPORT_TO_API void DestroySearcher(void* searcher);
+	extern "C" EXPORT_TO_API int SearchWith(void* searcher, const char16_t* str, int n, BOOL fold);
+
+	// Matcher functions.
+	extern "C" EXPORT_TO_API void* CreateMatcher(const char16_t* str, const int* offsets, int count);
+	extern "C" EXPORT_TO_API void DestroyMatcher(void* matcher);
+	extern "C" EXPORT_TO_API int MatchAll(void* matcher, const char16_t* str, int n, int* matches, int cap);
+
+	// String map functions.
+	extern "C" EXPORT_TO_API void* CreateStringMap(int capacity);
+	extern "C" EXPORT_TO_API void DestroyStringMap(void* map);
+	extern "C" EXPORT_TO_API BOOL StringMapAdd(void* map, const char16_t* str, int n, int64_t value, BOOL update);
+	extern "C" EXPORT_TO_API void StringMapClear(void* map);
+	extern "C" EXPORT_TO_API int StringMapCount(void* map);
+	extern "C" EXPORT_TO_API BOOL StringMapGet(void* map, const char16_t* str, int n, int64_t& value);
+	extern "C" EXPORT_TO_API int StringMapNext(void* map, int i, const char16_t*& str, int& n, int64_t& value);
+	extern "C" EXPORT_TO_API BOOL StringMapRemove(void* map, const char16_t* str, int n);
+	extern "C" EXPORT_TO_API void StringMapReserve(void* map, int n);
+
+	// Tokenizer functions.
+	extern "C" EXPORT_TO_API void* CreateTokenizer(const char16_t* str, int n, const char16_t* str1, int n1, char16_t quote, char16_t escape);
+	extern "C" EXPORT_TO_API void DestroyTokenizer(void* tokenizer);
+	extern "C" EXPORT_TO_API int Tokenize(void* tokenizer, const char16_t* str, int n, BOOL last, int* spans, int cap, int& consumed);
+
+	// File functions.
+	extern "C" EXPORT_TO_API int64_t SearchFile(const char16_t* path, const char16_t* str, int n, circus::text::file_search_callback callback, void* state);
+
+	// Line index functions.
+	extern "C" EXPORT_TO_API void* CreateFileLineIndex(const char16_t* path);
+	extern "C" EXPORT_TO_API void* CreateLineIndex(const char16_t* str, int n);
+	extern "C" EXPORT_TO_API void DestroyLineIndex(void* index);
+	extern "C" EXPORT_TO_API int LineIndexCount(void* index);
+	extern "C" EXPORT_TO_API int LineIndexFind(void* index, int64_t offset);
+	extern "C" EXPORT_TO_API int64_t LineIndexStart(void* index, int line);
+	extern "C" EXPORT_TO_API BOOL LineIndexUpdate(void* index, const char16_t* str, int n, int pos, int removed, int inserted);
+
+	// N-gram index functions.
+	extern "C" EXPORT_TO_API void* CreateNgramIndex(BOOL fold);
+	extern "C" EXPORT_TO_API void DestroyNgramIndex(void* index);
+	extern "C" EXPORT_TO_API BOOL NgramIndexAdd(void* index, int64_t id, const char16_t* str, int n);
+	extern "C" EXPORT_TO_API void NgramIndexAddBatch(void* index, const int64_t* ids, const char16_t* str, const int* offsets, int count);
+	extern "C" EXPORT_TO_API void NgramIndexClear(void* index);
+	extern "C" EXPORT_TO_API int NgramIndexCount(void* index);
+	extern "C" EXPORT_TO_API int NgramIndexFind(void* index, const char16_t* str, int n, int64_t* ids, int cap);
+	extern "C" EXPORT_TO_API BOOL NgramIndexRemove(void* index, int64_t id);
+
+	// Intern pool functions.
+	extern "C" EXPORT_TO_API void* CreateInternPool();
+	extern "C" EXPORT_TO_API void DestroyInternPool(void* pool);
+	extern "C" EXPORT_TO_API int Intern(void* pool, const char16_t* str, int n);
+	extern "C" EXPORT_TO_API BOOL InternBatch(void* pool, const char16_t* str, const int* offsets, int count, int* ids);
+	extern "C" EXPORT_TO_API int InternPoolCount(void* pool);
+	extern "C" EXPORT_TO_API int InternPoolFind(void* pool, const char16_t* str, int n);
+	extern "C" EXPORT_TO_API BOOL InternPoolGet(void* pool, int id, const char16_t*& str, int& n, uint64_t& hash);
 
 	// Numeric functions.
+	extern "C" EXPORT_TO_API int BucketIndex(uint64_t hash, int slot);
+	extern "C" EXPORT_TO_API BOOL BucketIndexBatch(const uint64_t* hashes, int count, int slot, int* indices);
+	extern "C" EXPORT_TO_API int64_t CountPrimes(int64_t lo, int64_t hi);
 	extern "C" EXPORT_TO_API BOOL IsPrime(int value);
+	extern "C" EXPORT_TO_API BOOL IsPrime64(int64_t value);
+	extern "C" EXPORT_TO_API int64_t LadderPrime(int slot);
+	extern "C" EXPORT_TO_API int LadderSlot(int64_t size);
 	extern "C" EXPORT_TO_API int NextPrime(int value);
+	extern "C" EXPORT_TO_API int64_t NextPrime64(int64_t value);
 	extern "C" EXPORT_TO_API int PreviousPrime(int value);
+	extern "C" EXPORT_TO_API int64_t PreviousPrime64(int64_t value);
+	extern "C" EXPORT_TO_API int PrimeBound();
+	extern "C" EXPORT_TO_API int64_t PrimesInRange(int64_t lo, int64_t hi, int64_t* primes, int64_t capacity);
+	extern "C" EXPORT_TO_API BOOL SetPrimeBound(int value);
 
 	// Environment functions.
 	extern "C" EXPORT_TO_API BOOL MonitorSize(int flag, double& width, double& height);
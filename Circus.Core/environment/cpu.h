@@ -0,0 +1,46 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Processor instruction sets available at runtime.
+//
+// SSE2 is always available on x64 and is used as the baseline. Functions
+// with faster kernels select them from these flags when the library is
+// loaded, so the same binary runs on any x64 processor.
+
+
+#pragma once
+
+#include "detail/cpu-detail.h"
+
+namespace circus {
+
+	namespace environment {
+
+		namespace cpu {
+
+			inline bool Avx2() {
+				return cpu::detail::Get().avx2;
+			}
+
+			inline bool Ssse3() {
+				return cpu::detail::Get().ssse3;
+			}
+
+		} // namespace cpu
+
+	} // namespace environment
+
+} // namespace circus
@@ -0,0 +1,81 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <intrin.h>
+
+namespace circus {
+
+	namespace environment {
+
+		namespace cpu {
+
+			namespace detail {
+
+				struct features {
+					bool ssse3;
+					bool sse41;
+					bool sse42;
+					bool popcnt;
+					bool aes;
+					bool pclmul;
+					bool avx2;
+					bool bmi2;
+				};
+
+				// Reads the instruction sets from cpuid. AVX2 also requires
+				// the OS to save ymm registers on context switches, which is
+				// checked with xgetbv.
+				static inline features Detect() {
+					features f = {};
+					int r[4];
+					__cpuid(r, 0);
+					auto const n = r[0];
+					if (n < 1) {
+						return f;
+					}
+					__cpuid(r, 1);
+					f.ssse3 = (r[2] & (1 << 9)) != 0;
+					f.sse41 = (r[2] & (1 << 19)) != 0;
+					f.sse42 = (r[2] & (1 << 20)) != 0;
+					f.popcnt = (r[2] & (1 << 23)) != 0;
+					f.aes = (r[2] & (1 << 25)) != 0;
+					f.pclmul = (r[2] & (1 << 1)) != 0;
+					auto const avx = (r[2] & (1 << 28)) != 0;
+					auto const osxsave = (r[2] & (1 << 27)) != 0;
+					auto const ymm = osxsave && (_xgetbv(0) & 0x6) == 0x6;
+					if (n >= 7) {
+						__cpuidex(r, 7, 0);
+						f.avx2 = avx && ymm && (r[1] & (1 << 5)) != 0;
+						f.bmi2 = (r[1] & (1 << 8)) != 0;
+					}
+					return f;
+				}
+
+				// Features are read once, the first time they are needed.
+				static inline const features& Get() {
+					static const features f = Detect();
+					return f;
+				}
+
+			} // namespace detail
+
+		} // namespace cpu
+
+	} // namespace environment
+
+} // namespace circus
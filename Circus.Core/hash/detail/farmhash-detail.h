@@ -40,6 +40,8 @@
 #define uint64_in_expected_order(x) (x)
 
 #include <assert.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
 #include <string.h>
 #include <utility>
 
@@ -102,6 +104,90 @@ namespace circus {
                 return BasicRotate64(val, shift);
             }
 
+            // Reads a CLR UTF-16 buffer as the 1 byte per char sequence made of
+            // the low byte of each char. This is what hash functions have always
+            // been fed with, so values are unchanged while the narrowed copy is
+            // never allocated. Fetch functions pack 8 (or 4) chars at once.
+            struct narrow_ptr {
+                const char16_t* p;
+
+                char operator[](size_t i) const {
+                    return static_cast<char>(p[i]);
+                }
+
+                narrow_ptr operator+(size_t i) const {
+                    return narrow_ptr{ p + i };
+                }
+
+                narrow_ptr operator-(size_t i) const {
+                    return narrow_ptr{ p - i };
+                }
+
+                narrow_ptr& operator+=(size_t i) {
+                    p += i;
+                    return *this;
+                }
+
+                bool operator==(const narrow_ptr& other) const {
+                    return p == other.p;
+                }
+
+                bool operator!=(const narrow_ptr& other) const {
+                    return p != other.p;
+                }
+            };
+
+            static inline uint32_t Fetch32(narrow_ptr p) {
+                const __m128i v = _mm_and_si128(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p.p)), _mm_set1_epi16(0xff));
+                return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(v, v)));
+            }
+
+            static inline uint64_t Fetch64(narrow_ptr p) {
+                const __m128i v = _mm_and_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p.p)), _mm_set1_epi16(0xff));
+                return static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_packus_epi16(v, v)));
+            }
+
+            // Same as narrow_ptr, but Fetch functions gather the low bytes with a
+            // single SSSE3 shuffle instead of a mask and a pack. Requires SSSE3.
+            struct narrow_ssse3_ptr {
+                const char16_t* p;
+
+                char operator[](size_t i) const {
+                    return static_cast<char>(p[i]);
+                }
+
+                narrow_ssse3_ptr operator+(size_t i) const {
+                    return narrow_ssse3_ptr{ p + i };
+                }
+
+                narrow_ssse3_ptr operator-(size_t i) const {
+                    return narrow_ssse3_ptr{ p - i };
+                }
+
+                narrow_ssse3_ptr& operator+=(size_t i) {
+                    p += i;
+                    return *this;
+                }
+
+                bool operator==(const narrow_ssse3_ptr& other) const {
+                    return p == other.p;
+                }
+
+                bool operator!=(const narrow_ssse3_ptr& other) const {
+                    return p != other.p;
+                }
+            };
+
+            static inline uint32_t Fetch32(narrow_ssse3_ptr p) {
+                const __m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p.p));
+                return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_shuffle_epi8(v, _mm_setr_epi8(0, 2, 4, 6, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1))));
+            }
+
+            static inline uint64_t Fetch64(narrow_ssse3_ptr p) {
+                const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p.p));
+                return static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_shuffle_epi8(v, _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, -1, -1, -1, -1, -1, -1, -1, -1))));
+            }
+
         }  // namespace details
 
         using namespace detail;
@@ -131,7 +217,8 @@ namespace circus {
                 return b;
             }
 
-            static inline uint64_t HashLen0to16(const char* s, size_t len) {
+            template <typename S>
+            static inline uint64_t HashLen0to16(S s, size_t len) {
                 if (len >= 8) {
                     uint64_t mul = k2 + len * 2;
                     uint64_t a = Fetch(s) + k2;
@@ -156,7 +243,8 @@ namespace circus {
                 return k2;
             }
 
-            static inline uint64_t HashLen17to32(const char* s, size_t len) {
+            template <typename S>
+            static inline uint64_t HashLen17to32(S s, size_t len) {
                 uint64_t mul = k2 + len * 2;
                 uint64_t a = Fetch(s) * k1;
                 uint64_t b = Fetch(s + 8);
@@ -175,11 +263,13 @@ namespace circus {
                 return make_pair(a + z, b + c);
             }
 
-            static inline pair<uint64_t, uint64_t> WeakHashLen32WithSeeds(const char* s, uint64_t a, uint64_t b) {
+            template <typename S>
+            static inline pair<uint64_t, uint64_t> WeakHashLen32WithSeeds(S s, uint64_t a, uint64_t b) {
                 return WeakHashLen32WithSeeds(Fetch(s), Fetch(s + 8), Fetch(s + 16), Fetch(s + 24), a, b);
             }
 
-            static inline uint64_t HashLen33to64(const char* s, size_t len) {
+            template <typename S>
+            static inline uint64_t HashLen33to64(S s, size_t len) {
                 uint64_t mul = k2 + len * 2;
                 uint64_t a = Fetch(s) * k2;
                 uint64_t b = Fetch(s + 8);
@@ -194,7 +284,8 @@ namespace circus {
                 return HashLen16(Rotate(e + f, 43) + Rotate(g, 30) + h, e + Rotate(f + a, 18) + g, mul);
             }
 
-            uint64_t Hash64(const char* s, size_t len) {
+            template <typename S>
+            uint64_t Hash64(S s, size_t len) {
                 const uint64_t seed = 81;
                 if (len <= 32) {
                     if (len <= 16) {
@@ -217,8 +308,8 @@ namespace circus {
                 x = x * k2 + Fetch(s);
 
                 // Set end so that after the loop we have 1 to 64 bytes left to process.
-                const char* end = s + ((len - 1) / 64) * 64;
-                const char* last64 = end + ((len - 1) & 63) - 63;
+                S end = s + ((len - 1) / 64) * 64;
+                S last64 = end + ((len - 1) & 63) - 63;
                 assert(s + len - 64 == last64);
                 do {
                     x = Rotate(x + y + v.first + Fetch(s + 8), 37) * k1;
@@ -249,13 +340,16 @@ namespace circus {
                 return HashLen16(HashLen16(v.first, w.first, mul) + ShiftMix(y) * k0 + z, HashLen16(v.second, w.second, mul) + x, mul);
             }
 
-            uint64_t Hash64WithSeeds(const char* s, size_t len, uint64_t seed0, uint64_t seed1);
+            template <typename S>
+            uint64_t Hash64WithSeeds(S s, size_t len, uint64_t seed0, uint64_t seed1);
 
-            uint64_t Hash64WithSeed(const char* s, size_t len, uint64_t seed) {
+            template <typename S>
+            uint64_t Hash64WithSeed(S s, size_t len, uint64_t seed) {
                 return Hash64WithSeeds(s, len, k2, seed);
             }
 
-            uint64_t Hash64WithSeeds(const char* s, size_t len, uint64_t seed0, uint64_t seed1) {
+            template <typename S>
+            uint64_t Hash64WithSeeds(S s, size_t len, uint64_t seed0, uint64_t seed1) {
                 return HashLen16(Hash64(s, len) - seed0, seed1);
             }
 
@@ -275,7 +369,8 @@ namespace circus {
                 return Rotate(b, r) * mul;
             }
 
-            uint64_t Hash64WithSeeds(const char* s, size_t len, uint64_t seed0, uint64_t seed1) {
+            template <typename S>
+            uint64_t Hash64WithSeeds(S s, size_t len, uint64_t seed0, uint64_t seed1) {
                 if (len <= 64) {
                     return farmn::Hash64WithSeeds(s, len, seed0, seed1);
                 }
@@ -291,8 +386,8 @@ namespace circus {
                 uint64_t mul = k2 + (u & 0x82);
 
                 // Set end so that after the loop we have 1 to 64 bytes left to process.
-                const char* end = s + ((len - 1) / 64) * 64;
-                const char* last64 = end + ((len - 1) & 63) - 63;
+                S end = s + ((len - 1) / 64) * 64;
+                S last64 = end + ((len - 1) & 63) - 63;
                 assert(s + len - 64 == last64);
                 do {
                     uint64_t a0 = Fetch(s);
@@ -362,11 +457,13 @@ namespace circus {
                 return H(farmn::HashLen16(v.first + x, w.first ^ y, mul) + z - u, H(v.second + y, w.second + z, k2, 30) ^ x, k2, 31);
             }
 
-            uint64_t Hash64WithSeed(const char* s, size_t len, uint64_t seed) {
+            template <typename S>
+            uint64_t Hash64WithSeed(S s, size_t len, uint64_t seed) {
                 return len <= 64 ? farmn::Hash64WithSeed(s, len, seed) : Hash64WithSeeds(s, len, 0, seed);
             }
 
-            uint64_t Hash64(const char* s, size_t len) {
+            template <typename S>
+            uint64_t Hash64(S s, size_t len) {
                 return len <= 64 ? farmn::Hash64(s, len) : Hash64WithSeeds(s, len, 81, 0);
             }
 
@@ -379,7 +476,8 @@ namespace circus {
         #undef Rotate
         #define Rotate Rotate64
 
-            static inline uint64_t H32(const char* s, size_t len, uint64_t mul, uint64_t seed0 = 0, uint64_t seed1 = 0) {
+            template <typename S>
+            static inline uint64_t H32(S s, size_t len, uint64_t mul, uint64_t seed0 = 0, uint64_t seed1 = 0) {
                 uint64_t a = Fetch(s) * k1;
                 uint64_t b = Fetch(s + 8);
                 uint64_t c = Fetch(s + len - 8) * mul;
@@ -391,7 +489,8 @@ namespace circus {
                 return b;
             }
 
-            static inline uint64_t HashLen33to64(const char* s, size_t len) {
+            template <typename S>
+            static inline uint64_t HashLen33to64(S s, size_t len) {
                 uint64_t mul0 = k2 - 30;
                 uint64_t mul1 = k2 - 30 + 2 * len;
                 uint64_t h0 = H32(s, 32, mul0);
@@ -399,7 +498,8 @@ namespace circus {
                 return ((h1 * mul1) + h0) * mul1;
             }
 
-            static inline uint64_t HashLen65to96(const char* s, size_t len) {
+            template <typename S>
+            static inline uint64_t HashLen65to96(S s, size_t len) {
                 uint64_t mul0 = k2 - 114;
                 uint64_t mul1 = k2 - 114 + 2 * len;
                 uint64_t h0 = H32(s, 32, mul0);
@@ -408,7 +508,8 @@ namespace circus {
                 return (h2 * 9 + (h0 >> 17) + (h1 >> 21))* mul1;
             }
 
-            uint64_t Hash64(const char* s, size_t len) {
+            template <typename S>
+            uint64_t Hash64(S s, size_t len) {
                 if (len <= 32) {
                     if (len <= 16) {
                         return farmn::HashLen0to16(s, len);
@@ -431,16 +532,130 @@ namespace circus {
                 }
             }
 
-            uint64_t Hash64WithSeeds(const char* s, size_t len, uint64_t seed0, uint64_t seed1) {
+            template <typename S>
+            uint64_t Hash64WithSeeds(S s, size_t len, uint64_t seed0, uint64_t seed1) {
                 return farmu::Hash64WithSeeds(s, len, seed0, seed1);
             }
 
-            uint64_t Hash64WithSeed(const char* s, size_t len, uint64_t seed) {
+            template <typename S>
+            uint64_t Hash64WithSeed(S s, size_t len, uint64_t seed) {
                 return farmu::Hash64WithSeed(s, len, seed);
             }
 
         }  // namespace farmx
 
+        namespace farmcc {
+
+        #undef Fetch
+        #define Fetch Fetch64
+        #undef Rotate
+        #define Rotate Rotate64
+
+            // A subroutine for CityHash128WithSeed(). Returns a decent 128-bit hash for
+            // strings of less than 128 bytes. Based on City and Murmur.
+            template <typename S>
+            static inline uint128_t CityMurmur(S s, size_t len, uint128_t seed) {
+                uint64_t a = Uint128Low64(seed);
+                uint64_t b = Uint128High64(seed);
+                uint64_t c = 0;
+                uint64_t d = 0;
+                int64_t l = static_cast<int64_t>(len) - 16;
+                if (l <= 0) {
+                    a = farmn::ShiftMix(a * k1) * k1;
+                    c = b * k1 + farmn::HashLen0to16(s, len);
+                    d = farmn::ShiftMix(a + (len >= 8 ? Fetch(s) : c));
+                }
+                else {
+                    c = farmn::HashLen16(Fetch(s + len - 8) + k1, a);
+                    d = farmn::HashLen16(b + len, c + Fetch(s + len - 16));
+                    a += d;
+                    do {
+                        a ^= farmn::ShiftMix(Fetch(s) * k1) * k1;
+                        a *= k1;
+                        b ^= a;
+                        c ^= farmn::ShiftMix(Fetch(s + 8) * k1) * k1;
+                        c *= k1;
+                        d ^= c;
+                        s += 16;
+                        l -= 16;
+                    } while (l > 0);
+                }
+                a = farmn::HashLen16(a, c);
+                b = farmn::HashLen16(d, b);
+                return Uint128(a ^ b, farmn::HashLen16(b, a));
+            }
+
+            template <typename S>
+            uint128_t CityHash128WithSeed(S s, size_t len, uint128_t seed) {
+                if (len < 128) {
+                    return CityMurmur(s, len, seed);
+                }
+
+                // We expect len >= 128 to be the common case. Keep 56 bytes of state: v, w, x, y, and z.
+                pair<uint64_t, uint64_t> v, w;
+                uint64_t x = Uint128Low64(seed);
+                uint64_t y = Uint128High64(seed);
+                uint64_t z = len * k1;
+                v.first = Rotate(y ^ k1, 49) * k1 + Fetch(s);
+                v.second = Rotate(v.first, 42) * k1 + Fetch(s + 8);
+                w.first = Rotate(y + z, 35) * k1 + x;
+                w.second = Rotate(x + Fetch(s + 88), 53) * k1;
+
+                // This is the same inner loop as CityHash64(), manually unrolled.
+                do {
+                    x = Rotate(x + y + v.first + Fetch(s + 8), 37) * k1;
+                    y = Rotate(y + v.second + Fetch(s + 48), 42) * k1;
+                    x ^= w.second;
+                    y += v.first + Fetch(s + 40);
+                    z = Rotate(z + w.first, 33) * k1;
+                    v = farmn::WeakHashLen32WithSeeds(s, v.second * k1, x + w.first);
+                    w = farmn::WeakHashLen32WithSeeds(s + 32, z + w.second, y + Fetch(s + 16));
+                    swap(z, x);
+                    s += 64;
+                    x = Rotate(x + y + v.first + Fetch(s + 8), 37) * k1;
+                    y = Rotate(y + v.second + Fetch(s + 48), 42) * k1;
+                    x ^= w.second;
+                    y += v.first + Fetch(s + 40);
+                    z = Rotate(z + w.first, 33) * k1;
+                    v = farmn::WeakHashLen32WithSeeds(s, v.second * k1, x + w.first);
+                    w = farmn::WeakHashLen32WithSeeds(s + 32, z + w.second, y + Fetch(s + 16));
+                    swap(z, x);
+                    s += 64;
+                    len -= 128;
+                } while (len >= 128);
+                x += Rotate(v.first + z, 49) * k0;
+                y = y * k0 + Rotate(w.second, 37);
+                z = z * k0 + Rotate(w.first, 27);
+                w.first *= 9;
+                v.first *= k0;
+
+                // If 0 < len < 128, hash up to 4 chunks of 32 bytes each from the end of s.
+                for (size_t tail_done = 0; tail_done < len; ) {
+                    tail_done += 32;
+                    y = Rotate(x + y, 42) * k0 + v.second;
+                    w.first += Fetch(s + len - tail_done + 16);
+                    x = x * k0 + w.first;
+                    z += w.second + Fetch(s + len - tail_done);
+                    w.second += v.first;
+                    v = farmn::WeakHashLen32WithSeeds(s + len - tail_done, v.first + z, v.second);
+                    v.first *= k0;
+                }
+
+                // At this point our 56 bytes of state should contain more than enough information
+                // for a strong 128-bit hash. We use two different 56-byte-to-8-byte hashes to get
+                // a good 128-bit hash.
+                x = farmn::HashLen16(x, v.first);
+                y = farmn::HashLen16(y + z, w.first);
+                return Uint128(farmn::HashLen16(x + v.second, w.second) + y, farmn::HashLen16(x + w.second, y + v.second));
+            }
+
+            template <typename S>
+            uint128_t Fingerprint128(S s, size_t len) {
+                return len >= 16 ? CityHash128WithSeed(s + 16, len - 16, Uint128(Fetch(s), Fetch(s + 8) + k0)) : CityHash128WithSeed(s, len, Uint128(k0, k1));
+            }
+
+        }  // namespace farmcc
+
     } // namespace farmhash
 
 } // namespace circus
@@ -0,0 +1,88 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Reduction constants of the capacity ladder.
+//
+// Lemire's fastmod computes n % d as the high bits of a product: with
+// M = floor((2^128 - 1) / d) + 1, the low 128 bits of M * n are the
+// fraction n / d scaled by 2^128, and multiplying them by d gives the
+// remainder in the high 64 bits. For a 32-bit d this is exact for any
+// 64-bit n (see "Faster Remainder by Direct Computation", Lemire, Kaser
+// and Kurz, 2019).
+
+
+#pragma once
+
+#include <intrin.h>
+#include <stdint.h>
+
+namespace circus {
+
+    namespace ladder {
+
+        namespace detail {
+
+            struct step {
+                uint32_t prime;
+                uint64_t lo;
+                uint64_t hi;
+            };
+
+            // Computes M by long division of 2^128 - 1 by 32-bit limbs.
+            static constexpr step make(uint32_t d) {
+                uint64_t q[4] = {};
+                uint64_t r = 0;
+                for (int i = 0; i < 4; ++i) {
+                    auto const n = (r << 32) | 0xffffffffu;
+                    q[i] = n / d;
+                    r = n % d;
+                }
+                auto const lo = ((q[2] << 32) | q[3]) + 1;
+                auto const hi = ((q[0] << 32) | q[1]) + (lo == 0 ? 1 : 0);
+                return step{ d, lo, hi };
+            }
+
+            // Past 7, each prime is the first prime above 1.5x the previous one.
+            static constexpr step steps[] = {
+                make(3u), make(5u), make(7u), make(11u), make(17u), make(29u), make(47u),
+                make(71u), make(107u), make(163u), make(251u), make(379u), make(569u), make(857u),
+                make(1289u), make(1949u), make(2927u), make(4391u), make(6599u), make(9901u),
+                make(14867u), make(22303u), make(33457u), make(50207u), make(75323u),
+                make(112997u), make(169501u), make(254257u), make(381389u), make(572087u),
+                make(858149u), make(1287233u), make(1930879u), make(2896319u), make(4344479u),
+                make(6516739u), make(9775111u), make(14662727u), make(21994111u), make(32991187u),
+                make(49486793u), make(74230231u), make(111345347u), make(167018021u),
+                make(250527047u), make(375790601u), make(563685907u), make(845528867u),
+                make(1268293309u), make(1902439967u), make(2853659981u), make(4280489981u)
+            };
+
+            static constexpr int size = sizeof(steps) / sizeof(steps[0]);
+
+            // Returns n % s.prime.
+            static inline uint32_t fastmod(uint64_t n, const step& s) {
+                uint64_t hi;
+                auto const lo = _umul128(s.lo, n, &hi);
+                hi += s.hi * n;
+                uint64_t r;
+                auto const t = _umul128(hi, s.prime, &r);
+                return (uint32_t)(r + (t + __umulh(lo, s.prime) < t ? 1 : 0));
+            }
+
+        } // namespace detail
+
+    } // namespace ladder
+
+} // namespace circus
@@ -17,8 +17,19 @@
 #pragma once
 #pragma warning(disable: 4267)
 
-#include <windef.h>
+#include <algorithm>
+#include <atomic>
+#include <intrin.h>
+#include <limits.h>
+#include <math.h>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
 #include <vector>
+#include <windef.h>
 
 namespace circus {
 
@@ -26,86 +37,287 @@ namespace circus {
 
 	    namespace detail {
 
-            // k0 and vector size are hardcoded for performance matters
-            // since cache size is not configurable by consumer. It allows 
-            // to have an optimal loop without multiple conditions checks 
-            // and vector reallocation.
+            // Default bound of the cache, 64 KB of bits.
+            static constexpr int k0 = 1 << 20;
+
+            // Bits sieved per segment, 32 KB to stay in L1.
+            static constexpr size_t k1 = 1 << 18;
+
+            // Odd-only bit-packed sieve: bit k is set when 2k + 1 is a prime.
+            struct sieve {
+                int bound;
+                std::vector<uint64_t> bits;
+
+                bool test(int i) const {
+                    auto const k = (size_t)i >> 1;
+                    return ((bits[k >> 6] >> (k & 63)) & 1) != 0;
+                }
+            };
+
+            static std::atomic<const sieve*> cache(nullptr);
+            static std::mutex lock;
+
+            // Sieves replaced by publish() are kept alive since lock-free readers
+            // may still hold them.
+            static std::vector<std::unique_ptr<sieve>> sieves;
 
-            static constexpr int k0 = 541;
-            static std::vector<int> array;
+            // Segmented Sieve of Eratosthenes over the odd values lo, lo + 2, ...
+            // of count bits, lo being odd. Each segment is crossed off by all of
+            // primes, then f(words, base, n) is called with its n bits, bit k
+            // standing for lo + 2 * (base + k). Primes must hold the odd primes
+            // up to the square root of the last value, in ascending order.
+            //
+            // Segments are k1 bits, or a sixteenth of the largest prime for large
+            // roots so that a segment is not mostly spent looping over primes.
+            // Primes below the segment size keep the bit of their next multiple,
+            // larger ones cross a segment at most once and find it by a division.
+            template <typename F>
+            static inline void segments(uint64_t lo, size_t count, const uint32_t* primes, size_t np, F f) {
+                auto const size = np == 0 ? k1 : std::max(k1, ((size_t)primes[np - 1] / 16 + 63) & ~(size_t)63);
+                auto const nn = (size_t)(std::lower_bound(primes, primes + np, (uint32_t)size) - primes);
+                std::vector<uint64_t> words(size >> 6);
 
-            // Sieve of the first 100 primes (last prime is k0).
-            // This is a basic straight-forward implementation of
-            // the Sieve of Eratosthenes since our cache is very
-            // small. Better optimized approches (i.e Wheel) should
-            // be considered if our cache size increases.
-            static inline void init() {
-                int a[k0] = { 0 };
-                for (int i = 2; i <= k0; i++) {
-                    for (int j = i * i; j <= k0; j += i) {
-                        a[j - 1] = 1;
+                // next[j] is the bit of the next odd multiple of primes[j] to cross,
+                // starting at its square.
+                std::vector<size_t> next(nn);
+                for (size_t j = 0; j < nn; ++j) {
+                    auto const p = (uint64_t)primes[j];
+                    auto m = p * p;
+                    if (m < lo) {
+                        m = (lo + p - 1) / p * p;
+                        if ((m & 1) == 0) {
+                            m += p;
+                        }
                     }
+                    next[j] = (size_t)((m - lo) >> 1);
                 }
-                array.reserve(100);
-                for (int i = 2; i <= k0; i++) {
-                    if (a[i - 1] == 0) {
-                        array.push_back(i);
+                for (size_t base = 0; base < count; base += size) {
+                    auto const n = std::min(size, count - base);
+                    auto const end = base + n;
+                    std::fill(words.begin(), words.begin() + ((n + 63) >> 6), ~0ull);
+                    for (size_t j = 0; j < nn; ++j) {
+                        auto const p = (size_t)primes[j];
+                        auto k = next[j];
+                        for (; k < end; k += p) {
+                            words[(k - base) >> 6] &= ~(1ull << ((k - base) & 63));
+                        }
+                        next[j] = k;
+                    }
+                    auto const first = lo + 2 * (uint64_t)base;
+                    auto const last = first + 2 * (uint64_t)(n - 1);
+                    for (size_t j = nn; j < np; ++j) {
+                        auto const p = (uint64_t)primes[j];
+                        auto m = p * p;
+                        if (m > last) {
+                            break;
+                        }
+                        if (m < first) {
+                            m = (first + p - 1) / p * p;
+                            if ((m & 1) == 0) {
+                                m += p;
+                            }
+                        }
+                        if (m <= last) {
+                            auto const k = (size_t)((m - first) >> 1);
+                            words[k >> 6] &= ~(1ull << (k & 63));
+                        }
                     }
+                    if (lo == 1 && base == 0) {
+                        words[0] &= ~1ull;
+                    }
+                    if ((n & 63) != 0) {
+                        words[n >> 6] &= (1ull << (n & 63)) - 1;
+                    }
+                    f(words.data(), base, n);
                 }
             }
 
-            static inline bool nearest(int i, int m, int dir) {
-                if (dir == 1) {
-                    return array[m > 0 ? m - 1 : 0] < i && array[m] > i;
+            // Returns the odd primes up to root, and maybe a few past it. Roots
+            // within the default bound use a plain sieve, larger ones are sieved
+            // by segments from the primes up to their square root.
+            static inline std::vector<uint32_t> base_primes(uint32_t root) {
+                std::vector<uint32_t> primes;
+                if (root <= (uint32_t)k0) {
+                    std::vector<char> composite(root + 1, 0);
+                    for (uint32_t i = 3; i <= root; i += 2) {
+                        if (composite[i] == 0) {
+                            primes.push_back(i);
+                            for (size_t j = (size_t)i * i; j <= (size_t)root; j += 2 * i) {
+                                composite[j] = 1;
+                            }
+                        }
+                    }
+                    return primes;
                 }
-                return array[m] < i && array[m < array.size() ? m + 1 : array.size()] > i;
+                auto const roots = base_primes((uint32_t)sqrt((double)root) + 1);
+                primes.reserve((size_t)(root / (log((double)root) - 1.1)));
+                segments(1, ((size_t)root >> 1) + 1, roots.data(), roots.size(), [&](const uint64_t* words, size_t base, size_t n) {
+                    for (size_t w = 0; w < (n + 63) >> 6; ++w) {
+                        unsigned long bit;
+                        for (auto m = words[w]; _BitScanForward64(&bit, m); m &= m - 1) {
+                            primes.push_back((uint32_t)(2 * (base + (w << 6) + bit) + 1));
+                        }
+                    }
+                });
+                return primes;
             }
 
-            // If match == true dir is omitted, otherwise return first 
-            // element < || > value. Return 0 if match == true and value 
-            // is not found.
-            static inline int bsearch(int i, int dir, bool match) {
-                auto const size = array.size();
-                if (size == 0) {
-                    init();
+            // Builds an odd-only cache up to bound. Returns nullptr if it could not
+            // be allocated.
+            static inline sieve* build(int bound) {
+                auto s = new (std::nothrow) sieve();
+                if (s == nullptr) {
+                    return nullptr;
+                }
+                s->bound = bound;
+                auto const count = ((size_t)bound >> 1) + 1;
+                try {
+                    s->bits.resize((count + 63) >> 6);
+                    auto const bits = s->bits.data();
+                    auto const primes = base_primes((uint32_t)sqrt((double)bound) + 1);
+                    segments(1, count, primes.data(), primes.size(), [=](const uint64_t* words, size_t base, size_t n) {
+                        memcpy(bits + (base >> 6), words, ((n + 63) >> 6) * sizeof(uint64_t));
+                    });
                 }
-                int l(0), r(size - 1), m(0);
-                while (r >= l) {
-                    m = (l + r) >> 1;
-                    if (array[m] == i || (!match && nearest(i, m, dir))) {
-                        return array[m];
+                catch (const std::bad_alloc&) {
+                    delete s;
+                    return nullptr;
+                }
+                return s;
+            }
+
+            // Builds a cache up to bound and publishes it. Must be called with
+            // lock held. Returns false if it could not be allocated.
+            static inline bool publish(int bound) {
+                std::unique_ptr<sieve> s(build(bound));
+                if (!s) {
+                    return false;
+                }
+                cache.store(s.get(), std::memory_order_release);
+                sieves.push_back(std::move(s));
+                return true;
+            }
+
+            // Returns the cache, built with the default bound on first use, or
+            // nullptr if it could not be allocated.
+            static inline const sieve* get() {
+                auto s = cache.load(std::memory_order_acquire);
+                if (s == nullptr) {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (cache.load(std::memory_order_relaxed) == nullptr) {
+                        publish(k0);
                     }
-                    else if (array[m] < i) {
-                        l = m + 1;
+                    s = cache.load(std::memory_order_acquire);
+                }
+                return s;
+            }
+
+            // Montgomery form modulo an odd n, so that modular products need no
+            // division: a is held as aR mod n with R = 2^64.
+            struct montgomery {
+                uint64_t n;
+                uint64_t inv;
+                uint64_t one;
+                uint64_t r2;
+
+                explicit montgomery(uint64_t m) : n(m) {
+
+                    // Newton iteration doubles the correct low bits of n^-1 mod
+                    // 2^64 at each step, starting from 3 bits since n * n = 1
+                    // mod 8.
+                    inv = n;
+                    for (int i = 0; i < 5; ++i) {
+                        inv *= 2 - n * inv;
                     }
-                    else {
-                        r = m - 1;
+                    one = (0 - n) % n;
+                    r2 = one;
+                    for (int i = 0; i < 64; ++i) {
+                        r2 = r2 >= n - r2 ? r2 - (n - r2) : r2 + r2;
                     }
                 }
-                return 0;
-            }
 
-            // Helper function to check if value is prime where value is odd.
-            static inline BOOL is_impl(int i) {
+                // Returns a * b / R mod n.
+                uint64_t mul(uint64_t a, uint64_t b) const {
+                    uint64_t hi;
+                    auto const lo = _umul128(a, b, &hi);
+                    auto const t = __umulh(lo * inv, n);
+                    return hi >= t ? hi - t : hi - t + n;
+                }
 
-                // Checks modulo 3 to reduce iterations in the next step.
-                // Note: value == 3 returns a false negative but this should 
-                // never happen since value < k0 is tested in cache.
-                if (i % 3 == 0) {
-                    return false;
+                uint64_t to(uint64_t a) const {
+                    return mul(a % n, r2);
+                }
+
+                uint64_t pow(uint64_t a, uint64_t e) const {
+                    auto r = one;
+                    for (; e != 0; e >>= 1) {
+                        if (e & 1) {
+                            r = mul(r, a);
+                        }
+                        a = mul(a, a);
+                    }
+                    return r;
                 }
-                for (int j = 5; j * j <= i; j += 6) {
-                    if (i % j == 0 || i % (j + 2) == 0) {
+            };
+
+            // Witnesses making Miller-Rabin deterministic below 4759123141
+            // (Jaeschke) and for any 64-bit value (Sinclair).
+            static constexpr uint64_t w32[] = { 2, 7, 61 };
+            static constexpr uint64_t w64[] = { 2, 325, 9375, 28178, 450775, 9780504, 1795265022 };
+
+            // Small odd primes checked by division first, which rejects most
+            // composites before the exponentiations.
+            static constexpr int small[] = { 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53 };
+
+            // Strong probable prime test of odd n > 53 to each witness.
+            template <size_t N>
+            static inline bool miller_rabin(uint64_t n, const uint64_t(&w)[N]) {
+                montgomery const m(n);
+                unsigned long s;
+                _BitScanForward64(&s, n - 1);
+                auto const d = (n - 1) >> s;
+                auto const minus_one = n - m.one;
+                for (size_t i = 0; i < N; ++i) {
+                    auto const a = w[i] % n;
+                    if (a == 0) {
+                        continue;
+                    }
+                    auto x = m.pow(m.to(a), d);
+                    if (x == m.one || x == minus_one) {
+                        continue;
+                    }
+                    unsigned long j = 1;
+                    for (; j < s; ++j) {
+                        x = m.mul(x, x);
+                        if (x == minus_one) {
+                            break;
+                        }
+                    }
+                    if (j == s) {
                         return false;
                     }
                 }
                 return true;
             }
 
+            // Helper function to check if value is prime where value is odd.
+            template <typename T>
+            static inline BOOL is_impl(T i) {
+                for (auto p : small) {
+                    if (i % p == 0) {
+                        return i == p;
+                    }
+                }
+                if (i < 59 * 59) {
+                    return true;
+                }
+                return (uint64_t)i < 4759123141ull ? miller_rabin((uint64_t)i, w32) : miller_rabin((uint64_t)i, w64);
+            }
+
             // Moves value to an odd and checks for next odds in a loop
-            // until a prime is found. For obvious performance matters 
-            // this function should not be called when value < k0 and 
-            // therefore contained in cache.
+            // until a prime is found. For obvious performance matters
+            // this function should not be called when value is within
+            // the bound and therefore contained in cache.
             static inline int search(int i, int dir) {
                 i += (i % 2) + dir;
                 for (int j = i;; j += dir * 2) {
@@ -115,18 +327,195 @@ namespace circus {
                 }
             }
 
+            // Largest prime below 2^63.
+            static constexpr int64_t k2 = INT64_MAX - 24;
+
+            // Same as search() for values past int range. Returns 0 if there is
+            // no next prime below 2^63.
+            static inline int64_t search(int64_t i, int dir) {
+                if (dir == 1 && i >= k2) {
+                    return 0;
+                }
+                i += (i % 2) + dir;
+                for (auto j = i;; j += dir * 2) {
+                    if (is_impl(j)) {
+                        return j;
+                    }
+                }
+            }
+
+            // Returns the first prime bit at or after k, or -1.
+            static inline int64_t scan_forward(const sieve* s, size_t k) {
+                auto const words = s->bits.data();
+                auto const size = s->bits.size();
+                auto w = k >> 6;
+                if (w >= size) {
+                    return -1;
+                }
+                auto m = words[w] & (~0ull << (k & 63));
+                for (;;) {
+                    unsigned long bit;
+                    if (_BitScanForward64(&bit, m)) {
+                        return (int64_t)((w << 6) + bit);
+                    }
+                    if (++w == size) {
+                        return -1;
+                    }
+                    m = words[w];
+                }
+            }
+
+            // Returns the last prime bit at or before k, or -1.
+            static inline int64_t scan_reverse(const sieve* s, size_t k) {
+                auto const words = s->bits.data();
+                auto w = k >> 6;
+                auto m = words[w] & (~0ull >> (63 - (k & 63)));
+                for (;;) {
+                    unsigned long bit;
+                    if (_BitScanReverse64(&bit, m)) {
+                        return (int64_t)((w << 6) + bit);
+                    }
+                    if (w-- == 0) {
+                        return -1;
+                    }
+                    m = words[w];
+                }
+            }
+
+            // Minimum number of odd values sieved by a thread of a range.
+            static constexpr size_t k3 = 1 << 22;
+
+            // Largest root of a range that is sieved, so values up to 2^56. Past
+            // it, or when the range is narrow compared to its root, values are
+            // tested one by one.
+            static constexpr uint32_t k4 = 1 << 28;
+
+            // Base primes of ranges past the cache, up to roots, grown by doubling
+            // and shared by later ranges. Ranges hold them while they sieve.
+            static std::shared_ptr<const std::vector<uint32_t>> roots;
+            static uint32_t roots_bound = 0;
+
+            // Returns base primes up to at least root, or nullptr if they could not
+            // be allocated.
+            static inline std::shared_ptr<const std::vector<uint32_t>> base(uint32_t root) {
+                std::lock_guard<std::mutex> guard(lock);
+                if (roots_bound < root) {
+                    auto const bound = std::min<uint64_t>(k4, std::max<uint64_t>(root, 2 * (uint64_t)roots_bound));
+                    try {
+                        roots = std::make_shared<const std::vector<uint32_t>>(base_primes((uint32_t)bound));
+                        roots_bound = (uint32_t)bound;
+                    }
+                    catch (const std::bad_alloc&) {
+                        return nullptr;
+                    }
+                }
+                return roots;
+            }
+
+            static inline int popcount(uint64_t w) {
+                w -= (w >> 1) & 0x5555555555555555ull;
+                w = (w & 0x3333333333333333ull) + ((w >> 2) & 0x3333333333333333ull);
+                w = (w + (w >> 4)) & 0x0f0f0f0f0f0f0f0full;
+                return (int)((w * 0x0101010101010101ull) >> 56);
+            }
+
+            // Odd values of a range [lo, lo + 2 * count) split in chunks of a
+            // multiple of 64 values, one per thread.
+            struct range {
+                uint64_t lo;
+                size_t count;
+                size_t step;
+                size_t chunks;
+                bool sieved;
+                std::shared_ptr<const std::vector<uint32_t>> primes;
+                size_t np;
+
+                range(uint64_t first, uint64_t last) : lo(first), count((size_t)((last - first) >> 1) + 1), np(0) {
+                    auto const n = std::max<size_t>(1, std::min<size_t>(std::thread::hardware_concurrency(), count / k3));
+                    step = (((count + n - 1) / n) + 63) & ~(size_t)63;
+                    chunks = (count + step - 1) / step;
+                    auto const root = (uint64_t)sqrt((double)last) + 1;
+                    sieved = root <= k4 && count >= root / 32;
+                    if (sieved) {
+                        auto const s = get();
+                        if (s != nullptr && (uint64_t)s->bound >= root) {
+                            std::vector<uint32_t> v;
+                            for (int i = 3; i <= (int)root; i += 2) {
+                                if (s->test(i)) {
+                                    v.push_back((uint32_t)i);
+                                }
+                            }
+                            primes = std::make_shared<const std::vector<uint32_t>>(std::move(v));
+                        }
+                        else {
+                            primes = base((uint32_t)root);
+                        }
+                        if (primes != nullptr) {
+                            np = (size_t)(std::upper_bound(primes->begin(), primes->end(), (uint32_t)root) - primes->begin());
+                        }
+                        else {
+                            sieved = false;
+                        }
+                    }
+                }
+
+                // Calls f(chunk, first, n) on a thread per chunk, for the n odd values
+                // of the chunk from first.
+                template <typename F>
+                void for_each(F f) const {
+                    std::vector<std::thread> threads;
+                    threads.reserve(chunks - 1);
+                    for (size_t i = 1; i < chunks; ++i) {
+                        threads.emplace_back(f, i, lo + 2 * (uint64_t)(i * step), std::min(step, count - i * step));
+                    }
+                    f(0, lo, std::min(step, count));
+                    for (auto& t : threads) {
+                        t.join();
+                    }
+                }
+
+                // Calls f(words, base, n) for each segment of n odd values from
+                // first, either sieved or tested one by one.
+                template <typename F>
+                void segments(uint64_t first, size_t n, F f) const {
+                    if (sieved) {
+                        detail::segments(first, n, primes->data(), np, f);
+                        return;
+                    }
+                    std::vector<uint64_t> words(k1 >> 6);
+                    for (size_t base = 0; base < n; base += k1) {
+                        auto const m = std::min(k1, n - base);
+                        std::fill(words.begin(), words.end(), 0);
+                        for (size_t k = 0; k < m; ++k) {
+                            auto const i = (int64_t)(first + 2 * (base + k));
+                            if (i < 9 ? i > 1 : is_impl(i)) {
+                                words[k >> 6] |= 1ull << (k & 63);
+                            }
+                        }
+                        f(words.data(), base, m);
+                    }
+                }
+            };
+
+            // Value is not a prime.
             int find(int i, int dir) {
                 if (i <= 2) {
                     return 2;
                 }
-                if (i > k0) {
+                auto const s = get();
+                auto const odd = dir == 1 ? i + 1 + (i & 1) : i - 1 - (i & 1);
+                if (s == nullptr || odd > s->bound) {
                     return search(i, dir);
                 }
-                return bsearch(i, dir, false);
+                if (dir == 1) {
+                    auto const k = scan_forward(s, (size_t)odd >> 1);
+                    return k >= 0 ? (int)(2 * k + 1) : search(s->bound, dir);
+                }
+                return (int)(2 * scan_reverse(s, (size_t)odd >> 1) + 1);
             }
 
 	    } // namespace detail
 
     } // namespace prime
 
-} // namespace circus
\ No newline at end of file
+} // namespace circus
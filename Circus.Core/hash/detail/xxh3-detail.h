@@ -0,0 +1,367 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// xxHash copyright notice:
+// Copyright (C) 2012-2021 Yann Collet
+//
+// BSD 2-Clause License (https://www.opensource.org/licenses/bsd-license.php)
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+//      notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+//      copyright notice, this list of conditions and the following disclaimer
+//      in the documentation and/or other materials provided with the
+//      distribution.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+//
+// Port of XXH3_64bits_withSeed() from xxHash 0.8.2. Values are the upstream
+// ones: XXH3 of the empty string with seed 0 is 2d06800538d394c2.
+//
+// Inputs above 240 bytes go through the long loop, whose SSE2 and AVX2
+// kernels are the upstream ones and return the same values. The kernel is
+// selected when the library is loaded.
+
+
+#pragma once
+
+#include <emmintrin.h>
+#include <immintrin.h>
+#include <intrin.h>
+#include <stdint.h>
+#include <string.h>
+#include "../../environment/cpu.h"
+#include "farmhash-detail.h"
+
+namespace circus {
+
+    namespace farmhash {
+
+        namespace xxh3 {
+
+            static const uint32_t kPrime32_1 = 0x9e3779b1U;
+            static const uint32_t kPrime32_2 = 0x85ebca77U;
+            static const uint32_t kPrime32_3 = 0xc2b2ae3dU;
+            static const uint64_t kPrime64_1 = 0x9e3779b185ebca87ULL;
+            static const uint64_t kPrime64_2 = 0xc2b2ae3d27d4eb4fULL;
+            static const uint64_t kPrime64_3 = 0x165667b19e3779f9ULL;
+            static const uint64_t kPrime64_4 = 0x85ebca77c2b2ae63ULL;
+            static const uint64_t kPrime64_5 = 0x27d4eb2f165667c5ULL;
+            static const uint64_t kPrimeMx1 = 0x165667919e3779f9ULL;
+            static const uint64_t kPrimeMx2 = 0x9fb21c651e98df25ULL;
+
+            static const size_t kSecretSize = 192;
+            static const size_t kStripeLen = 64;
+            static const size_t kSecretConsumeRate = 8;
+            static const size_t kMidSizeMax = 240;
+            static const size_t kMidSizeStartOffset = 3;
+            static const size_t kMidSizeLastOffset = 17;
+            static const size_t kSecretSizeMin = 136;
+            static const size_t kSecretLastAccStart = 7;
+            static const size_t kSecretMergeAccsStart = 11;
+
+            // Default secret, taken from FARSH.
+            alignas(64) static const unsigned char kSecretBytes[kSecretSize] = {
+                0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+                0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+                0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+                0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+                0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+                0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+                0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+                0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+                0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+                0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+                0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+                0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+            };
+
+            static const char* const kSecret = reinterpret_cast<const char*>(kSecretBytes);
+
+            static inline uint64_t Mul128Fold64(uint64_t lhs, uint64_t rhs) {
+                uint64_t hi;
+                uint64_t lo = _umul128(lhs, rhs, &hi);
+                return lo ^ hi;
+            }
+
+            // XXH64_avalanche().
+            static inline uint64_t Avalanche64(uint64_t h) {
+                h ^= h >> 33;
+                h *= kPrime64_2;
+                h ^= h >> 29;
+                h *= kPrime64_3;
+                h ^= h >> 32;
+                return h;
+            }
+
+            static inline uint64_t Avalanche(uint64_t h) {
+                h ^= h >> 37;
+                h *= kPrimeMx1;
+                h ^= h >> 32;
+                return h;
+            }
+
+            // Rotate64() rotates right: 15 and 40 are the upstream left
+            // rotations by 49 and 24.
+            static inline uint64_t Rrmxmx(uint64_t h, uint64_t len) {
+                h ^= Rotate64(h, 15) ^ Rotate64(h, 40);
+                h *= kPrimeMx2;
+                h ^= (h >> 35) + len;
+                h *= kPrimeMx2;
+                h ^= h >> 28;
+                return h;
+            }
+
+            static inline uint64_t HashLen1to3(const char* s, size_t len, const char* secret, uint64_t seed) {
+                uint8_t c1 = static_cast<uint8_t>(s[0]);
+                uint8_t c2 = static_cast<uint8_t>(s[len >> 1]);
+                uint8_t c3 = static_cast<uint8_t>(s[len - 1]);
+                uint32_t combined = ((uint32_t)c1 << 16) | ((uint32_t)c2 << 24) | ((uint32_t)c3 << 0) | ((uint32_t)len << 8);
+                uint64_t bitflip = (Fetch32(secret) ^ Fetch32(secret + 4)) + seed;
+                return Avalanche64((uint64_t)combined ^ bitflip);
+            }
+
+            static inline uint64_t HashLen4to8(const char* s, size_t len, const char* secret, uint64_t seed) {
+                seed ^= (uint64_t)_byteswap_ulong((uint32_t)seed) << 32;
+                uint32_t input1 = Fetch32(s);
+                uint32_t input2 = Fetch32(s + len - 4);
+                uint64_t bitflip = (Fetch64(secret + 8) ^ Fetch64(secret + 16)) - seed;
+                uint64_t input64 = input2 + ((uint64_t)input1 << 32);
+                return Rrmxmx(input64 ^ bitflip, len);
+            }
+
+            static inline uint64_t HashLen9to16(const char* s, size_t len, const char* secret, uint64_t seed) {
+                uint64_t bitflip1 = (Fetch64(secret + 24) ^ Fetch64(secret + 32)) + seed;
+                uint64_t bitflip2 = (Fetch64(secret + 40) ^ Fetch64(secret + 48)) - seed;
+                uint64_t input_lo = Fetch64(s) ^ bitflip1;
+                uint64_t input_hi = Fetch64(s + len - 8) ^ bitflip2;
+                uint64_t acc = len + Bswap64(input_lo) + input_hi + Mul128Fold64(input_lo, input_hi);
+                return Avalanche(acc);
+            }
+
+            static inline uint64_t HashLen0to16(const char* s, size_t len, const char* secret, uint64_t seed) {
+                if (len > 8) {
+                    return HashLen9to16(s, len, secret, seed);
+                }
+                if (len >= 4) {
+                    return HashLen4to8(s, len, secret, seed);
+                }
+                if (len > 0) {
+                    return HashLen1to3(s, len, secret, seed);
+                }
+                return Avalanche64(seed ^ (Fetch64(secret + 56) ^ Fetch64(secret + 64)));
+            }
+
+            static inline uint64_t Mix16B(const char* s, const char* secret, uint64_t seed) {
+                uint64_t input_lo = Fetch64(s);
+                uint64_t input_hi = Fetch64(s + 8);
+                return Mul128Fold64(input_lo ^ (Fetch64(secret) + seed), input_hi ^ (Fetch64(secret + 8) - seed));
+            }
+
+            static inline uint64_t HashLen17to128(const char* s, size_t len, const char* secret, uint64_t seed) {
+                uint64_t acc = len * kPrime64_1;
+                if (len > 32) {
+                    if (len > 64) {
+                        if (len > 96) {
+                            acc += Mix16B(s + 48, secret + 96, seed);
+                            acc += Mix16B(s + len - 64, secret + 112, seed);
+                        }
+                        acc += Mix16B(s + 32, secret + 64, seed);
+                        acc += Mix16B(s + len - 48, secret + 80, seed);
+                    }
+                    acc += Mix16B(s + 16, secret + 32, seed);
+                    acc += Mix16B(s + len - 32, secret + 48, seed);
+                }
+                acc += Mix16B(s + 0, secret + 0, seed);
+                acc += Mix16B(s + len - 16, secret + 16, seed);
+                return Avalanche(acc);
+            }
+
+            static inline uint64_t HashLen129to240(const char* s, size_t len, const char* secret, uint64_t seed) {
+                uint64_t acc = len * kPrime64_1;
+                size_t rounds = len / 16;
+                for (size_t i = 0; i < 8; ++i) {
+                    acc += Mix16B(s + 16 * i, secret + 16 * i, seed);
+                }
+                uint64_t acc_end = Mix16B(s + len - 16, secret + kSecretSizeMin - kMidSizeLastOffset, seed);
+                acc = Avalanche(acc);
+                for (size_t i = 8; i < rounds; ++i) {
+                    acc_end += Mix16B(s + 16 * i, secret + 16 * (i - 8) + kMidSizeStartOffset, seed);
+                }
+                return Avalanche(acc + acc_end);
+            }
+
+            // Long loop kernels, accumulating a stripe into the 8 lanes of acc
+            // and scrambling them after each block.
+            struct sse2 {
+                static inline void Accumulate512(uint64_t* acc, const char* input, const char* secret) {
+                    __m128i* xacc = reinterpret_cast<__m128i*>(acc);
+                    const __m128i* xinput = reinterpret_cast<const __m128i*>(input);
+                    const __m128i* xsecret = reinterpret_cast<const __m128i*>(secret);
+                    for (size_t i = 0; i < kStripeLen / sizeof(__m128i); ++i) {
+                        __m128i data_vec = _mm_loadu_si128(xinput + i);
+                        __m128i key_vec = _mm_loadu_si128(xsecret + i);
+                        __m128i data_key = _mm_xor_si128(data_vec, key_vec);
+                        __m128i data_key_lo = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+                        __m128i product = _mm_mul_epu32(data_key, data_key_lo);
+                        __m128i data_swap = _mm_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+                        __m128i sum = _mm_add_epi64(xacc[i], data_swap);
+                        xacc[i] = _mm_add_epi64(product, sum);
+                    }
+                }
+
+                static inline void ScrambleAcc(uint64_t* acc, const char* secret) {
+                    __m128i* xacc = reinterpret_cast<__m128i*>(acc);
+                    const __m128i* xsecret = reinterpret_cast<const __m128i*>(secret);
+                    const __m128i prime32 = _mm_set1_epi32((int)kPrime32_1);
+                    for (size_t i = 0; i < kStripeLen / sizeof(__m128i); ++i) {
+                        __m128i acc_vec = xacc[i];
+                        __m128i shifted = _mm_srli_epi64(acc_vec, 47);
+                        __m128i data_vec = _mm_xor_si128(acc_vec, shifted);
+                        __m128i key_vec = _mm_loadu_si128(xsecret + i);
+                        __m128i data_key = _mm_xor_si128(data_vec, key_vec);
+                        __m128i data_key_hi = _mm_shuffle_epi32(data_key, _MM_SHUFFLE(0, 3, 0, 1));
+                        __m128i prod_lo = _mm_mul_epu32(data_key, prime32);
+                        __m128i prod_hi = _mm_mul_epu32(data_key_hi, prime32);
+                        xacc[i] = _mm_add_epi64(prod_lo, _mm_slli_epi64(prod_hi, 32));
+                    }
+                }
+            };
+
+            struct avx2 {
+                static inline void Accumulate512(uint64_t* acc, const char* input, const char* secret) {
+                    __m256i* xacc = reinterpret_cast<__m256i*>(acc);
+                    const __m256i* xinput = reinterpret_cast<const __m256i*>(input);
+                    const __m256i* xsecret = reinterpret_cast<const __m256i*>(secret);
+                    for (size_t i = 0; i < kStripeLen / sizeof(__m256i); ++i) {
+                        __m256i data_vec = _mm256_loadu_si256(xinput + i);
+                        __m256i key_vec = _mm256_loadu_si256(xsecret + i);
+                        __m256i data_key = _mm256_xor_si256(data_vec, key_vec);
+                        __m256i data_key_lo = _mm256_srli_epi64(data_key, 32);
+                        __m256i product = _mm256_mul_epu32(data_key, data_key_lo);
+                        __m256i data_swap = _mm256_shuffle_epi32(data_vec, _MM_SHUFFLE(1, 0, 3, 2));
+                        __m256i sum = _mm256_add_epi64(xacc[i], data_swap);
+                        xacc[i] = _mm256_add_epi64(product, sum);
+                    }
+                }
+
+                static inline void ScrambleAcc(uint64_t* acc, const char* secret) {
+                    __m256i* xacc = reinterpret_cast<__m256i*>(acc);
+                    const __m256i* xsecret = reinterpret_cast<const __m256i*>(secret);
+                    const __m256i prime32 = _mm256_set1_epi32((int)kPrime32_1);
+                    for (size_t i = 0; i < kStripeLen / sizeof(__m256i); ++i) {
+                        __m256i acc_vec = xacc[i];
+                        __m256i shifted = _mm256_srli_epi64(acc_vec, 47);
+                        __m256i data_vec = _mm256_xor_si256(acc_vec, shifted);
+                        __m256i key_vec = _mm256_loadu_si256(xsecret + i);
+                        __m256i data_key = _mm256_xor_si256(data_vec, key_vec);
+                        __m256i data_key_hi = _mm256_srli_epi64(data_key, 32);
+                        __m256i prod_lo = _mm256_mul_epu32(data_key, prime32);
+                        __m256i prod_hi = _mm256_mul_epu32(data_key_hi, prime32);
+                        xacc[i] = _mm256_add_epi64(prod_lo, _mm256_slli_epi64(prod_hi, 32));
+                    }
+                }
+            };
+
+            // Derives the secret of a seed: the seed is added to the low word
+            // and subtracted from the high word of each 16 bytes.
+            static inline void InitCustomSecret(char* secret, uint64_t seed) {
+                for (size_t i = 0; i < kSecretSize / 16; ++i) {
+                    uint64_t lo = Fetch64(kSecret + 16 * i) + seed;
+                    uint64_t hi = Fetch64(kSecret + 16 * i + 8) - seed;
+                    memcpy(secret + 16 * i, &lo, sizeof(lo));
+                    memcpy(secret + 16 * i + 8, &hi, sizeof(hi));
+                }
+            }
+
+            static inline uint64_t MergeAccs(const uint64_t* acc, const char* secret, uint64_t start) {
+                uint64_t result = start;
+                for (size_t i = 0; i < 4; ++i) {
+                    result += Mul128Fold64(acc[2 * i] ^ Fetch64(secret + 16 * i), acc[2 * i + 1] ^ Fetch64(secret + 16 * i + 8));
+                }
+                return Avalanche(result);
+            }
+
+            template <typename K>
+            static inline void Accumulate(uint64_t* acc, const char* s, const char* secret, size_t stripes) {
+                for (size_t n = 0; n < stripes; ++n) {
+                    K::Accumulate512(acc, s + n * kStripeLen, secret + n * kSecretConsumeRate);
+                }
+            }
+
+            template <typename K>
+            static uint64_t HashLong(const char* s, size_t len, uint64_t seed) {
+                alignas(64) char custom[kSecretSize];
+                const char* secret = kSecret;
+                if (seed != 0) {
+                    InitCustomSecret(custom, seed);
+                    secret = custom;
+                }
+                alignas(32) uint64_t acc[8] = { kPrime32_3, kPrime64_1, kPrime64_2, kPrime64_3, kPrime64_4, kPrime32_2, kPrime64_5, kPrime32_1 };
+                size_t const stripes_per_block = (kSecretSize - kStripeLen) / kSecretConsumeRate;
+                size_t const block_len = kStripeLen * stripes_per_block;
+                size_t const blocks = (len - 1) / block_len;
+                for (size_t n = 0; n < blocks; ++n) {
+                    Accumulate<K>(acc, s + n * block_len, secret, stripes_per_block);
+                    K::ScrambleAcc(acc, secret + kSecretSize - kStripeLen);
+                }
+
+                // Last partial block, then the last stripe.
+                size_t const stripes = ((len - 1) - block_len * blocks) / kStripeLen;
+                Accumulate<K>(acc, s + blocks * block_len, secret, stripes);
+                K::Accumulate512(acc, s + len - kStripeLen, secret + kSecretSize - kStripeLen - kSecretLastAccStart);
+                return MergeAccs(acc, secret + kSecretMergeAccsStart, (uint64_t)len * kPrime64_1);
+            }
+
+            typedef uint64_t(*hash_long_fn)(const char*, size_t, uint64_t);
+
+            static const hash_long_fn long_kernel = environment::cpu::Avx2() ? HashLong<avx2> : HashLong<sse2>;
+
+            uint64_t Hash64WithSeed(const char* s, size_t len, uint64_t seed) {
+                if (len <= 16) {
+                    return HashLen0to16(s, len, kSecret, seed);
+                }
+                else if (len <= 128) {
+                    return HashLen17to128(s, len, kSecret, seed);
+                }
+                else if (len <= kMidSizeMax) {
+                    return HashLen129to240(s, len, kSecret, seed);
+                }
+                else {
+                    return long_kernel(s, len, seed);
+                }
+            }
+
+        }  // namespace xxh3
+
+    } // namespace farmhash
+
+} // namespace circus
@@ -51,21 +51,170 @@
 //
 // Farmhash in a non-crytographic algorythm, therefore it is not suited for
 // encrypting passwords and/or secured data.
+//
+// Seeded functions are provided for hash tables whose keys come from
+// external input. They hash the full UTF-16 chars (not their low byte),
+// otherwise chars sharing a low byte would collide for any seed. Seeds
+// make bucket collisions unpredictable without the seed, but for strings
+// up to 64 bytes they are mixed after the unseeded hash, so two strings
+// with the same unseeded hash still collide. This raises the bar from
+// bucket collisions to full 64-bit collisions; it is not a keyed PRF such
+// as SipHash. A random seed is drawn for the process when loaded.
+//
+// Batch functions hash count strings of a single blob, string i spanning
+// from offsets[i] to offsets[i + 1], with the same values as one call per
+// string. They save a P/Invoke per string, and large batches are split
+// across threads. Grouping strings by length class to hash several of them
+// in lockstep was measured slower than the plain loop, since independent
+// hashes already overlap in the pipeline. It is not used.
+//
+// Hashing a CLR string in place uses a kernel selected when the library is
+// loaded: SSSE3 gathers the low bytes of 8 chars with one shuffle, SSE2
+// masks and packs them. Both produce the same values, so hashes persisted
+// by former releases stay valid on any processor. The upstream SSE4 variant
+// (farmhashte) is not used: it returns other values for long strings.
+//
+// Hashes that never leave the process, those seeded with the process seed
+// or with the random seed of a table, go through hash64_local. It is XXH3
+// (see detail/xxh3-detail.h) over the full UTF-16 chars, whose long loop
+// runs the SSE2 or AVX2 kernel selected when the library is loaded. Its
+// values are not Farmhash ones and may change across releases, so they
+// must not be persisted. Seeded hash64 stays Farmhash for any seed.
+//
+// 128-bit functions are Farmhash Fingerprint128 and Hash128WithSeed (i.e.
+// CityHash128 v1.1.1) over the full UTF-16 chars, for content that is
+// deduplicated by hash at scales where 64 bits collide. The port matches
+// the upstream value of the empty string (3cb540c392e51e29 high,
+// 3df09dfc64c09a2b low) but has not been checked against the upstream
+// test data for 16 bytes or more. Deduplication persists fingerprints,
+// so they are not exported until that check pins their values.
 
 
 #pragma once
 
+#include <algorithm>
+#include <random>
 #include <stdint.h>
+#include <thread>
+#include <vector>
+#include "../environment/cpu.h"
 #include "detail/farmhash-detail.h"
+#include "detail/xxh3-detail.h"
 
 namespace circus {
 
     namespace farmhash {
 
+        namespace detail {
+
+            enum class hash_kernel {
+                sse2,
+                ssse3,
+                avx2
+            };
+
+            static const hash_kernel kernel = environment::cpu::Avx2() ? hash_kernel::avx2 : environment::cpu::Ssse3() ? hash_kernel::ssse3 : hash_kernel::sse2;
+
+        } // namespace detail
+
         uint64_t hash64(const char* str, size_t size) {
             return farmhash::farmx::Hash64(str, size);
         }
 
+        // Hashes a CLR string in place. Each char is read as its low byte to
+        // produce the same value than hashing the former narrowed copy.
+        uint64_t hash64(const char16_t* str, size_t size) {
+            switch (farmhash::detail::kernel) {
+            case farmhash::detail::hash_kernel::avx2:
+            case farmhash::detail::hash_kernel::ssse3:
+                return farmhash::farmx::Hash64(farmhash::detail::narrow_ssse3_ptr{ str }, size);
+            default:
+                return farmhash::farmx::Hash64(farmhash::detail::narrow_ptr{ str }, size);
+            }
+        }
+
+        uint64_t hash64(const char16_t* str, size_t size, uint64_t seed) {
+            return farmhash::farmx::Hash64WithSeed(reinterpret_cast<const char*>(str), size * sizeof(char16_t), seed);
+        }
+
+        // Hashes with a random seed, for values that are never persisted.
+        uint64_t hash64_local(const char16_t* str, size_t size, uint64_t seed) {
+            return farmhash::xxh3::Hash64WithSeed(reinterpret_cast<const char*>(str), size * sizeof(char16_t), seed);
+        }
+
+        uint64_t hash64(const char16_t* str, size_t size, uint64_t seed0, uint64_t seed1) {
+            return farmhash::farmx::Hash64WithSeeds(reinterpret_cast<const char*>(str), size * sizeof(char16_t), seed0, seed1);
+        }
+
+        namespace detail {
+
+            // Chars below which a batch is hashed on the calling thread.
+            static const size_t kBatchChars = 1 << 20;
+
+            template <typename F>
+            static inline void ForEachRange(const int* offsets, size_t count, F f) {
+                auto const chars = (size_t)(offsets[count] - offsets[0]);
+                auto const n = std::min<size_t>(std::thread::hardware_concurrency(), chars / kBatchChars);
+                if (n < 2) {
+                    f(0, count);
+                    return;
+                }
+                std::vector<std::thread> threads;
+                threads.reserve(n - 1);
+                auto const step = (count + n - 1) / n;
+                for (size_t i = step; i < count; i += step) {
+                    threads.emplace_back(f, i, std::min(i + step, count));
+                }
+                f(0, std::min(step, count));
+                for (auto& t : threads) {
+                    t.join();
+                }
+            }
+
+            static inline uint64_t RandomSeed() {
+                std::random_device r;
+                return ((uint64_t)r() << 32) | r();
+            }
+
+        } // namespace detail
+
+        // Per-process seed, drawn once when the library is loaded.
+        static const uint64_t seed = farmhash::detail::RandomSeed();
+
+        typedef farmhash::detail::uint128_t uint128_t;
+
+        uint128_t fingerprint128(const char16_t* str, size_t size) {
+            return farmhash::farmcc::Fingerprint128(reinterpret_cast<const char*>(str), size * sizeof(char16_t));
+        }
+
+        uint128_t hash128(const char16_t* str, size_t size, uint128_t seed) {
+            return farmhash::farmcc::CityHash128WithSeed(reinterpret_cast<const char*>(str), size * sizeof(char16_t), seed);
+        }
+
+        void hash64(const char16_t* blob, const int* offsets, size_t count, uint64_t* out) {
+            farmhash::detail::ForEachRange(offsets, count, [=](size_t first, size_t last) {
+                for (auto i = first; i < last; ++i) {
+                    out[i] = hash64(blob + offsets[i], offsets[i + 1] - offsets[i]);
+                }
+            });
+        }
+
+        void hash64(const char16_t* blob, const int* offsets, size_t count, uint64_t seed, uint64_t* out) {
+            farmhash::detail::ForEachRange(offsets, count, [=](size_t first, size_t last) {
+                for (auto i = first; i < last; ++i) {
+                    out[i] = hash64(blob + offsets[i], offsets[i + 1] - offsets[i], seed);
+                }
+            });
+        }
+
+        void hash64_local(const char16_t* blob, const int* offsets, size_t count, uint64_t seed, uint64_t* out) {
+            farmhash::detail::ForEachRange(offsets, count, [=](size_t first, size_t last) {
+                for (auto i = first; i < last; ++i) {
+                    out[i] = hash64_local(blob + offsets[i], offsets[i + 1] - offsets[i], seed);
+                }
+            });
+        }
+
     } // namespace farmhash
 
 } // namespace circus
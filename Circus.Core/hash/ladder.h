@@ -0,0 +1,68 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// A fixed ladder of prime capacities for hash tables, from 3 to about
+// 2^32 and about 1.5x apart.
+//
+// Reducing a hash to a bucket with % costs a 64-bit division, that is
+// tens of cycles on the hottest path of a lookup. Each step of the ladder
+// carries precomputed fastmod constants (see detail/ladder-detail.h), so
+// that the reduction is a few multiplications and gives the same index as
+// hash % prime. The constants are computed at compile time.
+//
+// Tables grow by moving to another slot of the ladder rather than to the
+// next prime of an arbitrary size.
+
+
+#pragma once
+
+#include <algorithm>
+#include <stdint.h>
+
+#include "detail/ladder-detail.h"
+
+namespace circus {
+
+    namespace ladder {
+
+        // Returns the prime of slot, or 0 if slot is out of the ladder.
+        int64_t prime(int slot) {
+            return slot >= 0 && slot < detail::size ? detail::steps[slot].prime : 0;
+        }
+
+        // Returns the first slot whose prime is at least size, or -1 if size
+        // is past the ladder.
+        int slot(int64_t size) {
+            auto const end = detail::steps + detail::size;
+            auto const it = std::lower_bound(detail::steps, end, size, [](const detail::step& s, int64_t n) { return s.prime < n; });
+            return it != end ? (int)(it - detail::steps) : -1;
+        }
+
+        // Returns hash % prime(slot). Slot must be in the ladder.
+        uint32_t index(uint64_t hash, int slot) {
+            return detail::fastmod(hash, detail::steps[slot]);
+        }
+
+        void index(const uint64_t* hashes, size_t count, int slot, int32_t* out) {
+            auto const s = detail::steps[slot];
+            for (size_t i = 0; i < count; ++i) {
+                out[i] = (int32_t)detail::fastmod(hashes[i], s);
+            }
+        }
+
+    } // namespace ladder
+
+} // namespace circus
@@ -20,10 +20,27 @@
 // to use for most cases, and then have some functions to calculate the
 // previous or next prime when a larger set is required.
 //
-// Cache is populated by a Sieve at first run containing the first 100
-// primes (ends at 541). This allows to perform a binary search on static
-// data when value is within range, otherwise fall back to the calculation
-// functions.
+// Cache is a bit-packed odd-only segmented sieve built at first run up to
+// 2^20 (64 KB), or up to the bound set by reserve(). Values within the
+// bound are checked with a bit test and next/previous primes are found by
+// scanning words, otherwise fall back to the calculation functions.
+//
+// The calculation functions screen a few small primes, then run a
+// deterministic Miller-Rabin test with Montgomery multiplication: the
+// witnesses 2, 7 and 61 cover values below 4759123141 and a set of 7
+// witnesses covers any 64-bit value. A check costs at most a few hundred
+// modular products rather than sqrt(n) / 3 divisions.
+//
+// Ranges are split in chunks sieved in parallel, by segments of 32 KB of
+// bits that stay in L1, larger for roots past 2^22. Base primes past the
+// cache are sieved once and kept for later ranges. Ranges above 2^56, or
+// narrow compared to their square root, are tested value by value instead
+// since sieving them would mostly cost the base primes.
+//
+// The cache is built once under a lock and published through an atomic
+// pointer, so lookups are lock-free. Calling reserve() publishes a new
+// cache while readers may still use the former one, which is kept until
+// the library is unloaded. The bound should be set once at startup.
 
 
 #pragma once
@@ -35,15 +52,22 @@ namespace circus {
 
     namespace prime {
 
+        // Returns the upper bound of the cache.
+        int bound() {
+            auto const s = prime::detail::get();
+            return s != nullptr ? s->bound : 0;
+        }
+
         BOOL is(int i) {
             if (i < 2 || (i > 2 && i % 2 == 0)) {
                 return false;
             }
-            if (i < prime::detail::k0) {
-
-                // Use any value for dir since it will be omitted 
-                // in BinarySearch due to match == true.
-                return prime::detail::bsearch(i, 0, true) != 0;
+            if (i < 9) {
+                return true;
+            }
+            auto const s = prime::detail::get();
+            if (s != nullptr && i <= s->bound) {
+                return s->test(i);
             }
             return prime::detail::is_impl(i);
         }
@@ -60,6 +84,132 @@ namespace circus {
             return prime::detail::find(i, dir);
         }
 
+        // 64-bit overloads. Values in int range use the cache.
+        BOOL is(int64_t i) {
+            if (i <= INT_MAX) {
+                return i > 1 && prime::is((int)i);
+            }
+            return i % 2 != 0 && prime::detail::is_impl(i);
+        }
+
+        // Same as next(int, int), but returns 0 if dir == 1 and there is no
+        // prime left below 2^63.
+        int64_t next(int64_t i, int dir) {
+            if (i <= INT_MAX) {
+                return prime::next((int)(i > 0 ? i : 0), dir);
+            }
+            if (abs(dir) != 1) {
+                return 0;
+            }
+            if (prime::is(i)) {
+                return i;
+            }
+            return prime::detail::search(i, dir);
+        }
+
+        // Returns the number of primes in [lo, hi].
+        int64_t count(int64_t lo, int64_t hi) {
+            lo = lo > 2 ? lo : 2;
+            if (hi < lo) {
+                return 0;
+            }
+            int64_t r = lo == 2 ? 1 : 0;
+            auto const first = (uint64_t)(lo | 1);
+            auto const last = (uint64_t)(hi - 1 + (hi & 1));
+            if (last < first) {
+                return r;
+            }
+            prime::detail::range const odds(first, last);
+            std::vector<int64_t> counts(odds.chunks);
+            odds.for_each([&](size_t chunk, uint64_t first, size_t n) {
+                int64_t c = 0;
+                odds.segments(first, n, [&](const uint64_t* words, size_t, size_t m) {
+                    for (size_t w = 0; w < (m + 63) >> 6; ++w) {
+                        c += prime::detail::popcount(words[w]);
+                    }
+                });
+                counts[chunk] = c;
+            });
+            for (auto c : counts) {
+                r += c;
+            }
+            return r;
+        }
+
+        // Outputs the primes in [lo, hi] in ascending order, up to capacity of
+        // them, and returns the number of primes in [lo, hi], or -1 if the
+        // range could not be allocated.
+        int64_t range(int64_t lo, int64_t hi, int64_t* out, int64_t capacity) {
+            lo = lo > 2 ? lo : 2;
+            if (hi < lo) {
+                return 0;
+            }
+            int64_t r = 0;
+            if (lo == 2) {
+                if (capacity > 0) {
+                    out[0] = 2;
+                }
+                r = 1;
+            }
+            auto const first = (uint64_t)(lo | 1);
+            auto const last = (uint64_t)(hi - 1 + (hi & 1));
+            if (last < first) {
+                return r;
+            }
+
+            // Chunks are sieved to bits in parallel, then counted to find where
+            // each one starts in out, and decoded in parallel.
+            prime::detail::range const odds(first, last);
+            std::vector<std::vector<uint64_t>> bits(odds.chunks);
+            try {
+                for (size_t i = 0; i < odds.chunks; ++i) {
+                    bits[i].resize((std::min(odds.step, odds.count - i * odds.step) + 63) >> 6);
+                }
+            }
+            catch (const std::bad_alloc&) {
+                return -1;
+            }
+            std::vector<int64_t> offsets(odds.chunks + 1);
+            odds.for_each([&](size_t chunk, uint64_t first, size_t n) {
+                auto const b = bits[chunk].data();
+                int64_t c = 0;
+                odds.segments(first, n, [&](const uint64_t* words, size_t base, size_t m) {
+                    auto const size = (m + 63) >> 6;
+                    memcpy(b + (base >> 6), words, size * sizeof(uint64_t));
+                    for (size_t w = 0; w < size; ++w) {
+                        c += prime::detail::popcount(words[w]);
+                    }
+                });
+                offsets[chunk + 1] = c;
+            });
+            offsets[0] = r;
+            for (size_t i = 0; i < odds.chunks; ++i) {
+                offsets[i + 1] += offsets[i];
+            }
+            odds.for_each([&](size_t chunk, uint64_t first, size_t) {
+                auto const& b = bits[chunk];
+                auto j = offsets[chunk];
+                for (size_t w = 0; w < b.size() && j < capacity; ++w) {
+                    unsigned long bit;
+                    for (auto m = b[w]; _BitScanForward64(&bit, m) && j < capacity; m &= m - 1) {
+                        out[j++] = (int64_t)(first + 2 * ((w << 6) + bit));
+                    }
+                }
+            });
+            return offsets[odds.chunks];
+        }
+
+        // Rebuilds the cache up to bound (at least 3). Returns false if it could
+        // not be allocated, in which case the former cache is kept.
+        bool reserve(int bound) {
+            if (bound < 3) {
+                return false;
+            }
+            std::lock_guard<std::mutex> guard(prime::detail::lock);
+            auto const s = prime::detail::cache.load(std::memory_order_relaxed);
+            return (s != nullptr && s->bound == bound) || prime::detail::publish(bound);
+        }
+
     } // namespace prime
 
 } // namespace circus
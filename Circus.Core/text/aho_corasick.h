@@ -0,0 +1,261 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// An Aho-Corasick automaton to find many patterns in a single pass.
+//
+// Patterns are provided as a single char16_t blob where pattern i spans
+// from offsets[i] to offsets[i + 1]. Searching reports every occurrence
+// of every pattern, overlapping ones included, as (pattern id, offset)
+// pairs in text order.
+//
+// Transitions are stored in a double-array: state s goes to t on code c
+// when check[t] == s with t = base[s] + c. Base and check are interleaved
+// so that a transition reads a single 8 bytes unit. Chars are first mapped
+// to a compact alphabet (codes 1..k for chars used by patterns, 0 for any
+// other char) through a two-level table, which keeps the array dense
+// despite the 16-bit char range.
+//
+// Failure links are followed at search time instead of building a full
+// DFA, since a DFA over thousands of patterns would be k times larger.
+// Dictionary links skip states that do not end a pattern.
+//
+// Empty patterns are ignored. Identical patterns all report their own id.
+
+
+#pragma once
+
+#include <algorithm>
+#include <stdint.h>
+#include <utility>
+#include <vector>
+
+#include "basic_string_view.h"
+
+namespace circus {
+
+	namespace text {
+
+		class aho_corasick {
+		public:
+
+			// Types
+			typedef char16_t value_type;
+			typedef size_t size_type;
+
+		public:
+			aho_corasick() = delete;
+
+			aho_corasick(const aho_corasick& aho_corasick) = delete;
+
+			aho_corasick(const value_type* s, const int* offsets, int count) {
+				init(s, offsets, count);
+			}
+
+			aho_corasick& operator=(const aho_corasick& aho_corasick) = delete;
+
+			// Writes up to cap matches in out as (pattern id, offset) pairs and
+			// returns the total number of matches, which can be larger than cap.
+			inline size_type match(const basic_string_view& str, int* out, size_type cap) const;
+
+		private:
+			struct unit {
+				int32_t base;
+				int32_t check;
+			};
+
+			inline uint16_t code(value_type c) const;
+			inline void init(const value_type* s, const int* offsets, int count);
+			inline int32_t next(int32_t s, uint16_t c) const;
+
+		private:
+			std::vector<unit> units_;
+			std::vector<int32_t> fail_;
+			std::vector<int32_t> dict_;
+			std::vector<int32_t> output_;
+			std::vector<int32_t> same_;
+			std::vector<int32_t> lengths_;
+			std::vector<uint16_t> alphabet_;
+			uint16_t pages_[256];
+		};
+
+		inline uint16_t aho_corasick::code(value_type c) const {
+			return alphabet_[((size_t)pages_[c >> 8] << 8) | (c & 0xff)];
+		}
+
+		inline void aho_corasick::init(const value_type* s, const int* offsets, int count) {
+
+			// Alphabet. Page 0 is shared by all chars that no pattern uses.
+			std::fill(pages_, pages_ + 256, (uint16_t)0);
+			alphabet_.assign(256, 0);
+			uint16_t k = 0;
+			for (int i = 0; i < count; ++i) {
+				for (int j = offsets[i]; j < offsets[i + 1]; ++j) {
+					auto const c = s[j];
+					if (pages_[c >> 8] == 0) {
+						pages_[c >> 8] = (uint16_t)(alphabet_.size() >> 8);
+						alphabet_.resize(alphabet_.size() + 256, 0);
+					}
+					auto& a = alphabet_[((size_t)pages_[c >> 8] << 8) | (c & 0xff)];
+					if (a == 0) {
+						a = ++k;
+					}
+				}
+			}
+
+			// Trie with sorted children, used to place states in the double-array.
+			std::vector<std::vector<std::pair<uint16_t, int32_t>>> trie(1);
+			std::vector<int32_t> ends(1, -1);
+			same_.assign(count, -1);
+			lengths_.assign(count, 0);
+			for (int i = count - 1; i >= 0; --i) {
+				if (offsets[i + 1] == offsets[i]) {
+					continue;
+				}
+				int32_t t = 0;
+				for (int j = offsets[i]; j < offsets[i + 1]; ++j) {
+					auto const c = code(s[j]);
+					auto& children = trie[t];
+					auto it = std::lower_bound(children.begin(), children.end(), std::make_pair(c, (int32_t)0));
+					if (it == children.end() || it->first != c) {
+						auto const m = (int32_t)trie.size();
+						it = children.insert(it, std::make_pair(c, m));
+						trie.emplace_back();
+						ends.push_back(-1);
+					}
+					t = it->second;
+				}
+
+				// Patterns are inserted backward so that ids sharing a state
+				// are chained in ascending order.
+				same_[i] = ends[t];
+				ends[t] = i;
+				lengths_[i] = offsets[i + 1] - offsets[i];
+			}
+
+			// Place states breadth first. index maps a trie node to its unit.
+			std::vector<int32_t> index(trie.size(), 0);
+			std::vector<int32_t> queue(1, 0);
+			units_.assign(k + 1, unit{ 0, -1 });
+			units_[0].check = 0;
+			size_t first = 1;
+			for (size_t q = 0; q < queue.size(); ++q) {
+				auto const node = queue[q];
+				auto const& children = trie[node];
+				if (children.empty()) {
+					continue;
+				}
+				while (first < units_.size() && units_[first].check != -1) {
+					++first;
+				}
+				int32_t base = std::max<int32_t>(0, (int32_t)first - children[0].first);
+				for (;; ++base) {
+					if (units_.size() < (size_t)base + k + 1) {
+						units_.resize((size_t)base + k + 1, unit{ 0, -1 });
+					}
+					bool fits = true;
+					for (auto const& child : children) {
+						if (units_[base + child.first].check != -1) {
+							fits = false;
+							break;
+						}
+					}
+					if (fits) {
+						break;
+					}
+				}
+				units_[index[node]].base = base;
+				for (auto const& child : children) {
+					index[child.second] = base + child.first;
+					units_[base + child.first].check = index[node];
+					queue.push_back(child.second);
+				}
+			}
+
+			// Outputs, failure and dictionary links, also breadth first so that
+			// links of shorter states are known.
+			output_.assign(units_.size(), -1);
+			fail_.assign(units_.size(), 0);
+			dict_.assign(units_.size(), 0);
+			for (auto const node : queue) {
+				auto const t = index[node];
+				output_[t] = ends[node];
+				for (auto const& child : trie[node]) {
+					auto const u = index[child.second];
+					int32_t f = 0;
+					if (t != 0) {
+						for (f = fail_[t];; f = fail_[f]) {
+							auto const v = next(f, child.first);
+							if (v >= 0) {
+								f = v;
+								break;
+							}
+							if (f == 0) {
+								break;
+							}
+						}
+					}
+					fail_[u] = f;
+				}
+				if (t != 0) {
+					auto const f = fail_[t];
+					dict_[t] = output_[f] >= 0 ? f : dict_[f];
+				}
+			}
+		}
+
+		inline typename aho_corasick::size_type
+			aho_corasick::match(const basic_string_view& str, int* out, size_type cap) const {
+			size_type total = 0;
+			int32_t s = 0;
+			for (size_type i = 0; i < str.size(); ++i) {
+				auto const c = code(str[i]);
+				if (c == 0) {
+					s = 0;
+					continue;
+				}
+				for (;;) {
+					auto const t = next(s, c);
+					if (t >= 0) {
+						s = t;
+						break;
+					}
+					if (s == 0) {
+						break;
+					}
+					s = fail_[s];
+				}
+				for (auto o = output_[s] >= 0 ? s : dict_[s]; o != 0; o = dict_[o]) {
+					for (auto id = output_[o]; id >= 0; id = same_[id]) {
+						if (total < cap) {
+							out[total << 1] = id;
+							out[(total << 1) + 1] = (int)(i + 1 - lengths_[id]);
+						}
+						++total;
+					}
+				}
+			}
+			return total;
+		}
+
+		// Returns the unit reached from s on c, or -1.
+		inline int32_t aho_corasick::next(int32_t s, uint16_t c) const {
+			auto const t = units_[s].base + c;
+			return units_[t].check == s ? t : -1;
+		}
+
+	} // namespace text
+
+} // namespace circus
@@ -0,0 +1,305 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// A non-owning view over a CLR char16_t buffer.
+//
+// Unlike basic_string, the view does not copy the fixed buffer provided
+// to PInvokes. It holds the pointer and the size only, so building one is
+// free and no malloc/free pair is required per call. Since chars are not
+// narrowed, searching and comparing are also correct for chars beyond
+// Latin-1 (i.e. 'A' and U+0141 are not the same char).
+//
+// The caller owns the buffer and must keep it pinned for the lifetime of
+// the view. Like basic_string, it does not perform zero size checks and
+// the buffer is not expected to be null-terminated.
+//
+// Finding uses vectorized kernels that match the first and last chars
+// of the needle over a block of positions before comparing the others.
+// AVX2 is used when available, otherwise SSE2. See detail/search-detail.h.
+//
+// first_not_of and last_not_of compile the set chars into a char_set and
+// scan in O(n). See char_set.h for details.
+//
+// Hashing reads the buffer as if it was narrowed to 1 byte per char, so
+// values are the same as the ones provided by basic_string. See
+// hash/farmhash.h for details.
+//
+// find_all reports every occurrence in a single pass: each search resumes
+// the vectorized kernel right after the previous match (or past it, for
+// non-overlapping matches), and folded needles are folded once.
+//
+// Folded variants ignore case with the simple case folding of
+// detail/fold-detail.h. Strings that are equal once folded have the same
+// folded hash, so both can be used as a comparer pair.
+
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <string>
+#include <vector>
+
+#include "../hash/farmhash.h"
+#include "char_set.h"
+#include "detail/search-detail.h"
+
+namespace circus {
+
+	namespace text {
+
+		class basic_string_view {
+		public:
+
+			// Types
+			typedef std::char_traits<char16_t> traits_type;
+			typedef typename traits_type::char_type value_type;
+			typedef size_t size_type;
+			typedef const value_type& const_reference;
+
+			typedef const value_type* const_iterator;
+			static constexpr size_type npos = size_type(-1);
+
+		public:
+			basic_string_view() = delete;
+
+			basic_string_view(const value_type* s, size_type n) noexcept : data_(s), size_(n) {
+			}
+
+			const_reference operator[](size_type pos) const {
+				return *(begin() + pos);
+			}
+
+			const_iterator begin() const {
+				return data();
+			}
+
+			int compare(const basic_string_view& str) const {
+				const size_type n1(size()), n2(str.size());
+				const int r = traits_type::compare(data(), str.data(), std::min(n1, n2));
+				return r != 0 ? r : n1 > n2 ? 1 : n1 < n2 ? -1 : 0;
+			}
+
+			const value_type* data() const {
+				return data_;
+			}
+
+			const_iterator end() const {
+				return data() + size();
+			}
+
+			bool equals_folded(const basic_string_view& str) const {
+				return size() == str.size() && detail::equals_folded(data(), str.data(), size());
+			}
+
+			size_type first(const basic_string_view& str, size_type pos = 0) const {
+				return find(str.data(), pos, str.size());
+			}
+
+			// Calls f with the offset of each occurrence of str, ignoring case if
+			// folded, overlapping ones if set. Returns the number of occurrences.
+			template <typename F>
+			inline size_type find_all(const basic_string_view& str, bool folded, bool overlapping, F f) const;
+
+			size_type first_folded(const basic_string_view& str, size_type pos = 0) const {
+				return find_folded(str.data(), pos, str.size());
+			}
+
+			size_type first(value_type c, size_type pos = 0) const {
+				if (pos >= size()) {
+					return npos;
+				}
+				auto const r = traits_type::find(begin() + pos, size() - pos, c);
+				return r != nullptr ? r - begin() : npos;
+			}
+
+			size_type first_not_of(const basic_string_view& str, size_type pos = 0) const {
+				return first_not_of(str.data(), pos, str.size());
+			}
+
+			size_type first_not_of(const value_type* s, size_type pos = 0) const {
+				return first_not_of(s, pos, traitsLength(s));
+			}
+
+			size_type first_not_of(value_type c, size_type pos = 0) const {
+				return first_not_of(&c, pos, 1);
+			}
+
+			uint64_t hash() const {
+				return farmhash::hash64(data(), size());
+			}
+
+			inline uint64_t hash_folded() const;
+
+			size_type last(const basic_string_view& str, size_type pos = npos) const {
+				return rfind(str.data(), pos, str.size());
+			}
+
+			size_type last(value_type c, size_type pos = npos) const {
+				return rfind(&c, pos, 1);
+			}
+
+			size_type last_not_of(const basic_string_view& str, size_type pos = npos) const {
+				return last_not_of(str.data(), pos, str.size());
+			}
+
+			size_type last_not_of(const value_type* s, size_type pos = npos) const {
+				return last_not_of(s, pos, traitsLength(s));
+			}
+
+			size_type last_not_of(value_type c, size_type pos = npos) const {
+				return last_not_of(&c, pos, 1);
+			}
+
+			size_type length() const {
+				return size();
+			}
+
+			size_type size() const {
+				return size_;
+			}
+
+			static size_type traitsLength(const value_type* s);
+
+		private:
+			inline size_type find(const value_type* s, const size_type pos, const size_type n) const;
+			inline size_type find_folded(const value_type* s, const size_type pos, const size_type n) const;
+			inline size_type first_not_of(const value_type* s, size_type pos, size_type n) const;
+			inline size_type last_not_of(const value_type* s, size_type pos, size_type n) const;
+			inline size_type rfind(const value_type* s, const size_type pos, const size_type n) const;
+
+		private:
+			const value_type* data_;
+			size_type size_;
+		};
+
+		inline typename basic_string_view::size_type
+			basic_string_view::find(const value_type* s,
+				const size_type pos,
+				const size_type n) const {
+			auto const size = this->size();
+
+			// n + pos can overflow (eg pos == npos), guard against that by checking
+			// that n + pos does not wrap around.
+			if (n + pos > size || n + pos < pos) {
+				return npos;
+			}
+
+			if (n == 0) {
+				return pos;
+			}
+			auto const r = detail::find_kernel(data() + pos, size - pos, s, n);
+			return r != npos ? pos + r : npos;
+		}
+
+		template <typename F>
+		inline typename basic_string_view::size_type
+			basic_string_view::find_all(const basic_string_view& str, bool folded, bool overlapping, F f) const {
+			auto const n = str.size();
+			if (n == 0 || n > size()) {
+				return 0;
+			}
+			value_type buffer[256];
+			std::vector<value_type> v(folded && n > 256 ? n : 0);
+			auto s = str.data();
+			if (folded) {
+				auto const p = n > 256 ? v.data() : buffer;
+				detail::fold_copy(s, n, p);
+				s = p;
+			}
+			auto const kernel = folded ? detail::find_folded_kernel : detail::find_kernel;
+			auto const step = overlapping ? 1 : n;
+			size_type count = 0;
+			for (size_type pos = 0; pos + n <= size();) {
+				auto const r = kernel(data() + pos, size() - pos, s, n);
+				if (r == npos) {
+					break;
+				}
+				f(pos + r);
+				++count;
+				pos += r + step;
+			}
+			return count;
+		}
+
+		inline typename basic_string_view::size_type
+			basic_string_view::find_folded(const value_type* s,
+				const size_type pos,
+				const size_type n) const {
+			auto const size = this->size();
+			if (n + pos > size || n + pos < pos) {
+				return npos;
+			}
+			if (n == 0) {
+				return pos;
+			}
+
+			// Short needles are folded on the stack.
+			value_type buffer[256];
+			std::vector<value_type> v(n > 256 ? n : 0);
+			auto const folded = n > 256 ? v.data() : buffer;
+			detail::fold_copy(s, n, folded);
+			auto const r = detail::find_folded_kernel(data() + pos, size - pos, folded, n);
+			return r != npos ? pos + r : npos;
+		}
+
+		inline typename basic_string_view::size_type
+			basic_string_view::first_not_of(
+				const value_type* s,
+				size_type pos,
+				size_type n) const {
+			return pos < length() ? char_set(s, n).first_not_of(data(), size(), pos) : npos;
+		}
+
+		inline uint64_t basic_string_view::hash_folded() const {
+			auto const n = size();
+			value_type buffer[256];
+			std::vector<value_type> v(n > 256 ? n : 0);
+			auto const folded = n > 256 ? v.data() : buffer;
+			detail::fold_copy(data(), n, folded);
+			return farmhash::hash64(folded, n);
+		}
+
+		inline typename basic_string_view::size_type
+			basic_string_view::last_not_of(
+				const value_type* s,
+				size_type pos,
+				size_type n) const {
+			return char_set(s, n).last_not_of(data(), size(), pos);
+		}
+
+		inline typename basic_string_view::size_type
+			basic_string_view::rfind(const value_type* s,
+				const size_type pos,
+				const size_type n) const {
+			auto const size = this->size();
+			if (n > size) {
+				return npos;
+			}
+			if (n == 0) {
+				return std::min(pos, size);
+			}
+			return detail::rfind_kernel(data(), size, pos, s, n);
+		}
+
+		inline typename basic_string_view::size_type
+			basic_string_view::traitsLength(const value_type* s) {
+			return s ? traits_type::length(s) : 0;
+		}
+
+	} // namespace text
+
+} // namespace circus
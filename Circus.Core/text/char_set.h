@@ -0,0 +1,283 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// A compiled set of chars for first_of/first_not_of/last_not_of like scans.
+//
+// Looking up each char of a string in the set chars is O(n.m). The set is
+// compiled once into a 256-bit bitmap for Latin-1 chars plus a sorted
+// table for wider chars, so a lookup is O(1) for Latin-1 and O(log w)
+// otherwise, where w is the number of wide chars in the set.
+//
+// Scans classify 16 (SSSE3) or 32 (AVX2) chars per block with a nibble
+// lookup of the bitmap (see detail/char_set-detail.h), and only check wide
+// chars one by one when the set contains any. The kernel is selected when
+// the library is loaded; processors without SSSE3 use the bitmap alone.
+
+
+#pragma once
+
+#include <algorithm>
+#include <intrin.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "../environment/cpu.h"
+#include "detail/char_set-detail.h"
+
+namespace circus {
+
+	namespace text {
+
+		namespace detail {
+
+			static const char_kernel char_set_kernel = environment::cpu::Avx2() ? char_kernel::avx2 : environment::cpu::Ssse3() ? char_kernel::ssse3 : char_kernel::scalar;
+
+		} // namespace detail
+
+		class char_set {
+		public:
+
+			// Types
+			typedef char16_t value_type;
+			typedef size_t size_type;
+			static constexpr size_type npos = size_type(-1);
+
+		public:
+			char_set() = delete;
+
+			char_set(const value_type* s, size_type n) {
+				init(s, n);
+			}
+
+			bool contains(value_type c) const {
+				return c < 256 ? ((bits_[c >> 6] >> (c & 63)) & 1) != 0 : std::binary_search(wide_.begin(), wide_.end(), c);
+			}
+
+			// Returns the first char of p at or after pos that is in the set.
+			size_type first_of(const value_type* p, size_type n, size_type pos = 0) const {
+				switch (detail::char_set_kernel) {
+				case detail::char_kernel::avx2:
+					return first_of<32, detail::classify_avx2>(p, n, pos);
+				case detail::char_kernel::ssse3:
+					return first_of<16, detail::classify_ssse3>(p, n, pos);
+				default:
+					return first_of_scalar(p, pos, n);
+				}
+			}
+
+			// Calls f with the position of each char of p at or after pos that is
+			// in the set, in order, until f returns false.
+			template <typename F>
+			void for_each_of(const value_type* p, size_type n, size_type pos, F f) const {
+				switch (detail::char_set_kernel) {
+				case detail::char_kernel::avx2:
+					for_each_of<32, detail::classify_avx2>(p, n, pos, f);
+					break;
+				case detail::char_kernel::ssse3:
+					for_each_of<16, detail::classify_ssse3>(p, n, pos, f);
+					break;
+				default:
+					for_each_of_scalar(p, pos, n, f);
+					break;
+				}
+			}
+
+			// Returns the first char of p at or after pos that is not in the set.
+			size_type first_not_of(const value_type* p, size_type n, size_type pos = 0) const {
+				switch (detail::char_set_kernel) {
+				case detail::char_kernel::avx2:
+					return first_not_of<32, detail::classify_avx2>(p, n, pos);
+				case detail::char_kernel::ssse3:
+					return first_not_of<16, detail::classify_ssse3>(p, n, pos);
+				default:
+					return first_not_of_scalar(p, pos, n);
+				}
+			}
+
+			// Returns the last char of p at or before pos that is not in the set.
+			size_type last_not_of(const value_type* p, size_type n, size_type pos = npos) const {
+				if (n == 0) {
+					return npos;
+				}
+				auto const end = std::min(pos, n - 1) + 1;
+				switch (detail::char_set_kernel) {
+				case detail::char_kernel::avx2:
+					return last_not_of<32, detail::classify_avx2>(p, end);
+				case detail::char_kernel::ssse3:
+					return last_not_of<16, detail::classify_ssse3>(p, end);
+				default:
+					return last_not_of_scalar(p, end);
+				}
+			}
+
+		private:
+			typedef void(*classify_fn)(const value_type* p, const detail::char_tables& t, uint32_t& member, uint32_t& wide);
+
+			template <size_type W, classify_fn F>
+			inline size_type first_of(const value_type* p, size_type n, size_type i) const;
+			inline size_type first_of_scalar(const value_type* p, size_type i, size_type n) const;
+			template <size_type W, classify_fn F>
+			inline size_type first_not_of(const value_type* p, size_type n, size_type i) const;
+			inline size_type first_not_of_scalar(const value_type* p, size_type i, size_type n) const;
+			template <size_type W, classify_fn C, typename F>
+			inline void for_each_of(const value_type* p, size_type n, size_type i, F& f) const;
+			template <typename F>
+			inline void for_each_of_scalar(const value_type* p, size_type i, size_type n, F& f) const;
+			inline void init(const value_type* s, size_type n);
+			template <size_type W, classify_fn F>
+			inline size_type last_not_of(const value_type* p, size_type end) const;
+			inline size_type last_not_of_scalar(const value_type* p, size_type end) const;
+			template <size_type W, classify_fn F>
+			inline uint32_t misses(const value_type* p) const;
+
+		private:
+			uint64_t bits_[4];
+			detail::char_tables tables_;
+			std::vector<value_type> wide_;
+		};
+
+		template <typename char_set::size_type W, typename char_set::classify_fn F>
+		inline typename char_set::size_type
+			char_set::first_of(const value_type* p, size_type n, size_type i) const {
+			for (; i + W <= n; i += W) {
+				unsigned long bit;
+				if (_BitScanForward(&bit, ~misses<W, F>(p + i) & (uint32_t)((1ull << W) - 1))) {
+					return i + bit;
+				}
+			}
+			return first_of_scalar(p, i, n);
+		}
+
+		inline typename char_set::size_type
+			char_set::first_of_scalar(const value_type* p, size_type i, size_type n) const {
+			for (; i < n; ++i) {
+				if (contains(p[i])) {
+					return i;
+				}
+			}
+			return npos;
+		}
+
+		template <typename char_set::size_type W, typename char_set::classify_fn F>
+		inline typename char_set::size_type
+			char_set::first_not_of(const value_type* p, size_type n, size_type i) const {
+			for (; i + W <= n; i += W) {
+				unsigned long bit;
+				if (_BitScanForward(&bit, misses<W, F>(p + i))) {
+					return i + bit;
+				}
+			}
+			return first_not_of_scalar(p, i, n);
+		}
+
+		inline typename char_set::size_type
+			char_set::first_not_of_scalar(const value_type* p, size_type i, size_type n) const {
+			for (; i < n; ++i) {
+				if (!contains(p[i])) {
+					return i;
+				}
+			}
+			return npos;
+		}
+
+		template <typename char_set::size_type W, typename char_set::classify_fn C, typename F>
+		inline void char_set::for_each_of(const value_type* p, size_type n, size_type i, F& f) const {
+			for (; i + W <= n; i += W) {
+				unsigned long bit;
+				for (auto m = ~misses<W, C>(p + i) & (uint32_t)((1ull << W) - 1); _BitScanForward(&bit, m); m &= m - 1) {
+					if (!f(i + bit)) {
+						return;
+					}
+				}
+			}
+			for_each_of_scalar(p, i, n, f);
+		}
+
+		template <typename F>
+		inline void char_set::for_each_of_scalar(const value_type* p, size_type i, size_type n, F& f) const {
+			for (; i < n; ++i) {
+				if (contains(p[i]) && !f(i)) {
+					return;
+				}
+			}
+		}
+
+		inline void char_set::init(const value_type* s, size_type n) {
+			memset(bits_, 0, sizeof(bits_));
+			memset(&tables_, 0, sizeof(tables_));
+			for (size_type i = 0; i < n; ++i) {
+				auto const c = s[i];
+				if (c < 256) {
+					bits_[c >> 6] |= 1ull << (c & 63);
+					auto const hi = c >> 4;
+					if (hi < 8) {
+						tables_.row0[c & 15] |= (uint8_t)(1 << hi);
+					}
+					else {
+						tables_.row1[c & 15] |= (uint8_t)(1 << (hi - 8));
+					}
+				}
+				else {
+					wide_.push_back(c);
+				}
+			}
+			std::sort(wide_.begin(), wide_.end());
+			wide_.erase(std::unique(wide_.begin(), wide_.end()), wide_.end());
+		}
+
+		template <typename char_set::size_type W, typename char_set::classify_fn F>
+		inline typename char_set::size_type
+			char_set::last_not_of(const value_type* p, size_type end) const {
+			for (; end >= W; end -= W) {
+				unsigned long bit;
+				if (_BitScanReverse(&bit, misses<W, F>(p + end - W))) {
+					return end - W + bit;
+				}
+			}
+			return last_not_of_scalar(p, end);
+		}
+
+		inline typename char_set::size_type
+			char_set::last_not_of_scalar(const value_type* p, size_type end) const {
+			while (end-- > 0) {
+				if (!contains(p[end])) {
+					return end;
+				}
+			}
+			return npos;
+		}
+
+		// Returns a bit per char of the block that is not in the set.
+		template <typename char_set::size_type W, typename char_set::classify_fn F>
+		inline uint32_t char_set::misses(const value_type* p) const {
+			uint32_t member, wide;
+			F(p, tables_, member, wide);
+			uint32_t r = ~member & (uint32_t)((1ull << W) - 1);
+			if (!wide_.empty()) {
+				unsigned long bit;
+				for (uint32_t w = r & wide; _BitScanForward(&bit, w); w &= w - 1) {
+					if (contains(p[bit])) {
+						r &= ~(1u << bit);
+					}
+				}
+			}
+			return r;
+		}
+
+	} // namespace text
+
+} // namespace circus
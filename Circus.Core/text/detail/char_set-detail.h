@@ -0,0 +1,99 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <immintrin.h>
+#include <stdint.h>
+
+namespace circus {
+
+	namespace text {
+
+		namespace detail {
+
+			// Nibble lookup of a Latin-1 set over 16 or 32 chars at once.
+			//
+			// Chars are narrowed to their low byte b. For each low nibble, row0
+			// holds a bit per high nibble 0-7 set when the byte is in the set,
+			// row1 does the same for high nibbles 8-15. pshufb selects the row
+			// byte from the low nibble and the bit from the high nibble, so a
+			// char is a member when both have a bit in common.
+			//
+			// Both functions set a bit per char in member for Latin-1 members
+			// and in wide for chars above 0xff, which the caller checks itself.
+
+			struct char_tables {
+				alignas(16) uint8_t row0[16];
+				alignas(16) uint8_t row1[16];
+			};
+
+			static inline void classify_ssse3(const char16_t* p, const char_tables& t, uint32_t& member, uint32_t& wide) {
+				const __m128i zero = _mm_setzero_si128();
+				const __m128i low = _mm_set1_epi16(0xff);
+				const __m128i nibble = _mm_set1_epi8(0x0f);
+				const __m128i bits = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+				const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+				const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 8));
+				const __m128i bytes = _mm_packus_epi16(_mm_and_si128(a, low), _mm_and_si128(b, low));
+				const __m128i narrow = _mm_cmpeq_epi8(_mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)), zero);
+				const __m128i lo = _mm_and_si128(bytes, nibble);
+				const __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), nibble);
+				const __m128i upper = _mm_cmplt_epi8(bytes, zero);
+				const __m128i row = _mm_or_si128(
+					_mm_andnot_si128(upper, _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(t.row0)), lo)),
+					_mm_and_si128(upper, _mm_shuffle_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(t.row1)), lo)));
+				const __m128i out = _mm_cmpeq_epi8(_mm_and_si128(row, _mm_shuffle_epi8(bits, hi)), zero);
+				member = (uint32_t)_mm_movemask_epi8(_mm_andnot_si128(out, narrow));
+				wide = ~(uint32_t)_mm_movemask_epi8(narrow) & 0xffff;
+			}
+
+			static inline void classify_avx2(const char16_t* p, const char_tables& t, uint32_t& member, uint32_t& wide) {
+				const __m256i zero = _mm256_setzero_si256();
+				const __m256i low = _mm256_set1_epi16(0xff);
+				const __m256i nibble = _mm256_set1_epi8(0x0f);
+				const __m256i bits = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+					1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+				const __m256i row0 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t.row0)));
+				const __m256i row1 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(t.row1)));
+				const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+				const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 16));
+
+				// Packing works per 128-bit lane, permute restores chars order.
+				const __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_and_si256(a, low), _mm256_and_si256(b, low)), 0xd8);
+				const __m256i narrow = _mm256_cmpeq_epi8(_mm256_permute4x64_epi64(_mm256_packus_epi16(_mm256_srli_epi16(a, 8), _mm256_srli_epi16(b, 8)), 0xd8), zero);
+				const __m256i lo = _mm256_and_si256(bytes, nibble);
+				const __m256i hi = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), nibble);
+				const __m256i upper = _mm256_cmpgt_epi8(zero, bytes);
+				const __m256i row = _mm256_or_si256(
+					_mm256_andnot_si256(upper, _mm256_shuffle_epi8(row0, lo)),
+					_mm256_and_si256(upper, _mm256_shuffle_epi8(row1, lo)));
+				const __m256i out = _mm256_cmpeq_epi8(_mm256_and_si256(row, _mm256_shuffle_epi8(bits, hi)), zero);
+				member = (uint32_t)_mm256_movemask_epi8(_mm256_andnot_si256(out, narrow));
+				wide = ~(uint32_t)_mm256_movemask_epi8(narrow);
+			}
+
+			enum class char_kernel {
+				scalar,
+				ssse3,
+				avx2
+			};
+
+		} // namespace detail
+
+	} // namespace text
+
+} // namespace circus
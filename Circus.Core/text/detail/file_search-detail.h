@@ -0,0 +1,186 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Helpers of file_search: a read-only file mapping, UTF-8 encoding of
+// the value, and newline counting.
+
+
+#pragma once
+
+#include <emmintrin.h>
+#include <stdint.h>
+#include <string>
+#include <windows.h>
+
+namespace circus {
+
+	namespace text {
+
+		namespace detail {
+
+			// A read-only view of a whole file. data() is null if the file cannot
+			// be opened or mapped, or is empty.
+			class mapped_file {
+			public:
+				mapped_file(const mapped_file& file) = delete;
+
+				explicit mapped_file(const char16_t* path) : file_(INVALID_HANDLE_VALUE), mapping_(NULL), data_(nullptr), size_(0), opened_(false) {
+					file_ = CreateFileW(reinterpret_cast<LPCWSTR>(path), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+					if (file_ == INVALID_HANDLE_VALUE) {
+						return;
+					}
+					LARGE_INTEGER size;
+					if (!GetFileSizeEx(file_, &size)) {
+						return;
+					}
+					opened_ = true;
+					if (size.QuadPart == 0) {
+						return;
+					}
+					mapping_ = CreateFileMappingW(file_, NULL, PAGE_READONLY, 0, 0, NULL);
+					if (mapping_ == NULL) {
+						opened_ = false;
+						return;
+					}
+					data_ = static_cast<const char*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+					if (data_ == nullptr) {
+						opened_ = false;
+						return;
+					}
+					size_ = (size_t)size.QuadPart;
+				}
+
+				~mapped_file() {
+					if (data_ != nullptr) {
+						UnmapViewOfFile(data_);
+					}
+					if (mapping_ != NULL) {
+						CloseHandle(mapping_);
+					}
+					if (file_ != INVALID_HANDLE_VALUE) {
+						CloseHandle(file_);
+					}
+				}
+
+				mapped_file& operator=(const mapped_file& file) = delete;
+
+				const char* data() const {
+					return data_;
+				}
+
+				// Returns true if the file was opened and mapped, or is empty.
+				bool opened() const {
+					return opened_;
+				}
+
+				size_t size() const {
+					return size_;
+				}
+
+			private:
+				HANDLE file_;
+				HANDLE mapping_;
+				const char* data_;
+				size_t size_;
+				bool opened_;
+			};
+
+			// Returns the sum of the bytes of acc, where each byte is at most 255.
+			static inline size_t sum_bytes(__m128i acc) {
+				acc = _mm_sad_epu8(acc, _mm_setzero_si128());
+				return (size_t)_mm_cvtsi128_si32(acc) + (size_t)_mm_extract_epi16(acc, 4);
+			}
+
+			// Returns the number of '\n' units in [p, p + n). Matches are counted
+			// in byte lanes, which are summed every 255 blocks.
+			static inline size_t count_lines(const char* p, size_t n) {
+				const __m128i lf = _mm_set1_epi8('\n');
+				size_t r = 0;
+				size_t i = 0;
+				while (i + 16 <= n) {
+					__m128i acc = _mm_setzero_si128();
+					for (size_t k = 0; k < 255 && i + 16 <= n; ++k, i += 16) {
+						acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), lf));
+					}
+					r += sum_bytes(acc);
+				}
+				for (; i < n; ++i) {
+					r += p[i] == '\n';
+				}
+				return r;
+			}
+
+			static inline size_t count_lines(const char16_t* p, size_t n) {
+				const __m128i lf = _mm_set1_epi16(u'\n');
+				size_t r = 0;
+				size_t i = 0;
+				while (i + 16 <= n) {
+					__m128i acc = _mm_setzero_si128();
+					for (size_t k = 0; k < 255 && i + 16 <= n; ++k, i += 16) {
+						const __m128i a = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), lf);
+						const __m128i b = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 8)), lf);
+						acc = _mm_sub_epi8(acc, _mm_packs_epi16(a, b));
+					}
+					r += sum_bytes(acc);
+				}
+				for (; i < n; ++i) {
+					r += p[i] == u'\n';
+				}
+				return r;
+			}
+
+			// Returns the UTF-8 encoding of s. Unpaired surrogates are encoded as
+			// U+FFFD.
+			static inline std::string utf8(const char16_t* s, size_t n) {
+				std::string r;
+				r.reserve(n * 3);
+				for (size_t i = 0; i < n; ++i) {
+					uint32_t c = s[i];
+					if (c >= 0xd800 && c < 0xe000) {
+						if (c < 0xdc00 && i + 1 < n && s[i + 1] >= 0xdc00 && s[i + 1] < 0xe000) {
+							c = 0x10000 + ((c - 0xd800) << 10) + (s[++i] - 0xdc00);
+						}
+						else {
+							c = 0xfffd;
+						}
+					}
+					if (c < 0x80) {
+						r += (char)c;
+					}
+					else if (c < 0x800) {
+						r += (char)(0xc0 | (c >> 6));
+						r += (char)(0x80 | (c & 0x3f));
+					}
+					else if (c < 0x10000) {
+						r += (char)(0xe0 | (c >> 12));
+						r += (char)(0x80 | ((c >> 6) & 0x3f));
+						r += (char)(0x80 | (c & 0x3f));
+					}
+					else {
+						r += (char)(0xf0 | (c >> 18));
+						r += (char)(0x80 | ((c >> 12) & 0x3f));
+						r += (char)(0x80 | ((c >> 6) & 0x3f));
+						r += (char)(0x80 | (c & 0x3f));
+					}
+				}
+				return r;
+			}
+
+		} // namespace detail
+
+	} // namespace text
+
+} // namespace circus
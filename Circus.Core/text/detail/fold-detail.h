@@ -0,0 +1,201 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Simple case folding of UTF-16 chars.
+//
+// fold maps a char to its simple case folding (CaseFolding.txt, status C
+// and S) over the BMP, so that the 1:1 mappings of all scripts match. Full
+// foldings that expand to several chars (i.e. U+00DF to "ss") are not
+// applied, and surrogates are left as is.
+//
+// The 1194 mappings are packed into 192 ranges of a constant delta, either
+// contiguous or every other char (upper and lower case pairs alternate in
+// most Latin Extended blocks), that is 1.5 KB searched in O(log n). ASCII
+// is folded without the table.
+//
+// Vector kernels fold ASCII and Latin-1 in registers. Past Latin-1, and
+// for U+00B5 that folds to U+03BC, chars are reported as wide so that the
+// caller folds them with the table. Only 5 chars below U+0100 are the
+// folding of a wide char (k, s, U+00DF, U+00E5 and U+00FF), see
+// reached_by_wide.
+
+
+#pragma once
+
+#include <algorithm>
+#include <immintrin.h>
+#include <stdint.h>
+
+namespace circus {
+
+	namespace text {
+
+		namespace detail {
+
+			struct fold_range {
+				uint16_t lo;
+				uint16_t hi;
+				uint16_t delta;
+				uint16_t step;
+			};
+
+			// Generated from the Unicode 14.0 character database.
+			static const fold_range fold_ranges[] = {
+				{ 0x0041, 0x005a, 0x0020, 1 }, { 0x00b5, 0x00b5, 0x0307, 1 }, { 0x00c0, 0x00d6, 0x0020, 1 }, { 0x00d8, 0x00de, 0x0020, 1 },
+				{ 0x0100, 0x012e, 0x0001, 2 }, { 0x0132, 0x0136, 0x0001, 2 }, { 0x0139, 0x0147, 0x0001, 2 }, { 0x014a, 0x0176, 0x0001, 2 },
+				{ 0x0178, 0x0178, 0xff87, 1 }, { 0x0179, 0x017d, 0x0001, 2 }, { 0x017f, 0x017f, 0xfef4, 1 }, { 0x0181, 0x0181, 0x00d2, 1 },
+				{ 0x0182, 0x0184, 0x0001, 2 }, { 0x0186, 0x0186, 0x00ce, 1 }, { 0x0187, 0x0187, 0x0001, 1 }, { 0x0189, 0x018a, 0x00cd, 1 },
+				{ 0x018b, 0x018b, 0x0001, 1 }, { 0x018e, 0x018e, 0x004f, 1 }, { 0x018f, 0x018f, 0x00ca, 1 }, { 0x0190, 0x0190, 0x00cb, 1 },
+				{ 0x0191, 0x0191, 0x0001, 1 }, { 0x0193, 0x0193, 0x00cd, 1 }, { 0x0194, 0x0194, 0x00cf, 1 }, { 0x0196, 0x0196, 0x00d3, 1 },
+				{ 0x0197, 0x0197, 0x00d1, 1 }, { 0x0198, 0x0198, 0x0001, 1 }, { 0x019c, 0x019c, 0x00d3, 1 }, { 0x019d, 0x019d, 0x00d5, 1 },
+				{ 0x019f, 0x019f, 0x00d6, 1 }, { 0x01a0, 0x01a4, 0x0001, 2 }, { 0x01a6, 0x01a6, 0x00da, 1 }, { 0x01a7, 0x01a7, 0x0001, 1 },
+				{ 0x01a9, 0x01a9, 0x00da, 1 }, { 0x01ac, 0x01ac, 0x0001, 1 }, { 0x01ae, 0x01ae, 0x00da, 1 }, { 0x01af, 0x01af, 0x0001, 1 },
+				{ 0x01b1, 0x01b2, 0x00d9, 1 }, { 0x01b3, 0x01b5, 0x0001, 2 }, { 0x01b7, 0x01b7, 0x00db, 1 }, { 0x01b8, 0x01b8, 0x0001, 1 },
+				{ 0x01bc, 0x01bc, 0x0001, 1 }, { 0x01c4, 0x01c4, 0x0002, 1 }, { 0x01c5, 0x01c5, 0x0001, 1 }, { 0x01c7, 0x01c7, 0x0002, 1 },
+				{ 0x01c8, 0x01c8, 0x0001, 1 }, { 0x01ca, 0x01ca, 0x0002, 1 }, { 0x01cb, 0x01db, 0x0001, 2 }, { 0x01de, 0x01ee, 0x0001, 2 },
+				{ 0x01f1, 0x01f1, 0x0002, 1 }, { 0x01f2, 0x01f4, 0x0001, 2 }, { 0x01f6, 0x01f6, 0xff9f, 1 }, { 0x01f7, 0x01f7, 0xffc8, 1 },
+				{ 0x01f8, 0x021e, 0x0001, 2 }, { 0x0220, 0x0220, 0xff7e, 1 }, { 0x0222, 0x0232, 0x0001, 2 }, { 0x023a, 0x023a, 0x2a2b, 1 },
+				{ 0x023b, 0x023b, 0x0001, 1 }, { 0x023d, 0x023d, 0xff5d, 1 }, { 0x023e, 0x023e, 0x2a28, 1 }, { 0x0241, 0x0241, 0x0001, 1 },
+				{ 0x0243, 0x0243, 0xff3d, 1 }, { 0x0244, 0x0244, 0x0045, 1 }, { 0x0245, 0x0245, 0x0047, 1 }, { 0x0246, 0x024e, 0x0001, 2 },
+				{ 0x0345, 0x0345, 0x0074, 1 }, { 0x0370, 0x0372, 0x0001, 2 }, { 0x0376, 0x0376, 0x0001, 1 }, { 0x037f, 0x037f, 0x0074, 1 },
+				{ 0x0386, 0x0386, 0x0026, 1 }, { 0x0388, 0x038a, 0x0025, 1 }, { 0x038c, 0x038c, 0x0040, 1 }, { 0x038e, 0x038f, 0x003f, 1 },
+				{ 0x0391, 0x03a1, 0x0020, 1 }, { 0x03a3, 0x03ab, 0x0020, 1 }, { 0x03c2, 0x03c2, 0x0001, 1 }, { 0x03cf, 0x03cf, 0x0008, 1 },
+				{ 0x03d0, 0x03d0, 0xffe2, 1 }, { 0x03d1, 0x03d1, 0xffe7, 1 }, { 0x03d5, 0x03d5, 0xfff1, 1 }, { 0x03d6, 0x03d6, 0xffea, 1 },
+				{ 0x03d8, 0x03ee, 0x0001, 2 }, { 0x03f0, 0x03f0, 0xffca, 1 }, { 0x03f1, 0x03f1, 0xffd0, 1 }, { 0x03f4, 0x03f4, 0xffc4, 1 },
+				{ 0x03f5, 0x03f5, 0xffc0, 1 }, { 0x03f7, 0x03f7, 0x0001, 1 }, { 0x03f9, 0x03f9, 0xfff9, 1 }, { 0x03fa, 0x03fa, 0x0001, 1 },
+				{ 0x03fd, 0x03ff, 0xff7e, 1 }, { 0x0400, 0x040f, 0x0050, 1 }, { 0x0410, 0x042f, 0x0020, 1 }, { 0x0460, 0x0480, 0x0001, 2 },
+				{ 0x048a, 0x04be, 0x0001, 2 }, { 0x04c0, 0x04c0, 0x000f, 1 }, { 0x04c1, 0x04cd, 0x0001, 2 }, { 0x04d0, 0x052e, 0x0001, 2 },
+				{ 0x0531, 0x0556, 0x0030, 1 }, { 0x10a0, 0x10c5, 0x1c60, 1 }, { 0x10c7, 0x10c7, 0x1c60, 1 }, { 0x10cd, 0x10cd, 0x1c60, 1 },
+				{ 0x13f8, 0x13fd, 0xfff8, 1 }, { 0x1c80, 0x1c80, 0xe7b2, 1 }, { 0x1c81, 0x1c81, 0xe7b3, 1 }, { 0x1c82, 0x1c82, 0xe7bc, 1 },
+				{ 0x1c83, 0x1c84, 0xe7be, 1 }, { 0x1c85, 0x1c85, 0xe7bd, 1 }, { 0x1c86, 0x1c86, 0xe7c4, 1 }, { 0x1c87, 0x1c87, 0xe7dc, 1 },
+				{ 0x1c88, 0x1c88, 0x89c3, 1 }, { 0x1c90, 0x1cba, 0xf440, 1 }, { 0x1cbd, 0x1cbf, 0xf440, 1 }, { 0x1e00, 0x1e94, 0x0001, 2 },
+				{ 0x1e9b, 0x1e9b, 0xffc6, 1 }, { 0x1e9e, 0x1e9e, 0xe241, 1 }, { 0x1ea0, 0x1efe, 0x0001, 2 }, { 0x1f08, 0x1f0f, 0xfff8, 1 },
+				{ 0x1f18, 0x1f1d, 0xfff8, 1 }, { 0x1f28, 0x1f2f, 0xfff8, 1 }, { 0x1f38, 0x1f3f, 0xfff8, 1 }, { 0x1f48, 0x1f4d, 0xfff8, 1 },
+				{ 0x1f59, 0x1f5f, 0xfff8, 2 }, { 0x1f68, 0x1f6f, 0xfff8, 1 }, { 0x1f88, 0x1f8f, 0xfff8, 1 }, { 0x1f98, 0x1f9f, 0xfff8, 1 },
+				{ 0x1fa8, 0x1faf, 0xfff8, 1 }, { 0x1fb8, 0x1fb9, 0xfff8, 1 }, { 0x1fba, 0x1fbb, 0xffb6, 1 }, { 0x1fbc, 0x1fbc, 0xfff7, 1 },
+				{ 0x1fbe, 0x1fbe, 0xe3fb, 1 }, { 0x1fc8, 0x1fcb, 0xffaa, 1 }, { 0x1fcc, 0x1fcc, 0xfff7, 1 }, { 0x1fd8, 0x1fd9, 0xfff8, 1 },
+				{ 0x1fda, 0x1fdb, 0xff9c, 1 }, { 0x1fe8, 0x1fe9, 0xfff8, 1 }, { 0x1fea, 0x1feb, 0xff90, 1 }, { 0x1fec, 0x1fec, 0xfff9, 1 },
+				{ 0x1ff8, 0x1ff9, 0xff80, 1 }, { 0x1ffa, 0x1ffb, 0xff82, 1 }, { 0x1ffc, 0x1ffc, 0xfff7, 1 }, { 0x2126, 0x2126, 0xe2a3, 1 },
+				{ 0x212a, 0x212a, 0xdf41, 1 }, { 0x212b, 0x212b, 0xdfba, 1 }, { 0x2132, 0x2132, 0x001c, 1 }, { 0x2160, 0x216f, 0x0010, 1 },
+				{ 0x2183, 0x2183, 0x0001, 1 }, { 0x24b6, 0x24cf, 0x001a, 1 }, { 0x2c00, 0x2c2f, 0x0030, 1 }, { 0x2c60, 0x2c60, 0x0001, 1 },
+				{ 0x2c62, 0x2c62, 0xd609, 1 }, { 0x2c63, 0x2c63, 0xf11a, 1 }, { 0x2c64, 0x2c64, 0xd619, 1 }, { 0x2c67, 0x2c6b, 0x0001, 2 },
+				{ 0x2c6d, 0x2c6d, 0xd5e4, 1 }, { 0x2c6e, 0x2c6e, 0xd603, 1 }, { 0x2c6f, 0x2c6f, 0xd5e1, 1 }, { 0x2c70, 0x2c70, 0xd5e2, 1 },
+				{ 0x2c72, 0x2c72, 0x0001, 1 }, { 0x2c75, 0x2c75, 0x0001, 1 }, { 0x2c7e, 0x2c7f, 0xd5c1, 1 }, { 0x2c80, 0x2ce2, 0x0001, 2 },
+				{ 0x2ceb, 0x2ced, 0x0001, 2 }, { 0x2cf2, 0x2cf2, 0x0001, 1 }, { 0xa640, 0xa66c, 0x0001, 2 }, { 0xa680, 0xa69a, 0x0001, 2 },
+				{ 0xa722, 0xa72e, 0x0001, 2 }, { 0xa732, 0xa76e, 0x0001, 2 }, { 0xa779, 0xa77b, 0x0001, 2 }, { 0xa77d, 0xa77d, 0x75fc, 1 },
+				{ 0xa77e, 0xa786, 0x0001, 2 }, { 0xa78b, 0xa78b, 0x0001, 1 }, { 0xa78d, 0xa78d, 0x5ad8, 1 }, { 0xa790, 0xa792, 0x0001, 2 },
+				{ 0xa796, 0xa7a8, 0x0001, 2 }, { 0xa7aa, 0xa7aa, 0x5abc, 1 }, { 0xa7ab, 0xa7ab, 0x5ab1, 1 }, { 0xa7ac, 0xa7ac, 0x5ab5, 1 },
+				{ 0xa7ad, 0xa7ad, 0x5abf, 1 }, { 0xa7ae, 0xa7ae, 0x5abc, 1 }, { 0xa7b0, 0xa7b0, 0x5aee, 1 }, { 0xa7b1, 0xa7b1, 0x5ad6, 1 },
+				{ 0xa7b2, 0xa7b2, 0x5aeb, 1 }, { 0xa7b3, 0xa7b3, 0x03a0, 1 }, { 0xa7b4, 0xa7c2, 0x0001, 2 }, { 0xa7c4, 0xa7c4, 0xffd0, 1 },
+				{ 0xa7c5, 0xa7c5, 0x5abd, 1 }, { 0xa7c6, 0xa7c6, 0x75c8, 1 }, { 0xa7c7, 0xa7c9, 0x0001, 2 }, { 0xa7d0, 0xa7d0, 0x0001, 1 },
+				{ 0xa7d6, 0xa7d8, 0x0001, 2 }, { 0xa7f5, 0xa7f5, 0x0001, 1 }, { 0xab70, 0xabbf, 0x6830, 1 }, { 0xff21, 0xff3a, 0x0020, 1 }
+			};
+
+			static inline char16_t fold(char16_t c) {
+				if (c < 0x80) {
+					return c >= u'A' && c <= u'Z' ? c + 32 : c;
+				}
+				auto const r = std::upper_bound(std::begin(fold_ranges), std::end(fold_ranges), c, [](char16_t c, const fold_range& r) {
+					return c < r.lo;
+				});
+				if (r == std::begin(fold_ranges)) {
+					return c;
+				}
+				auto const& f = r[-1];
+				return c <= f.hi && (c - f.lo) % f.step == 0 ? (char16_t)(c + f.delta) : c;
+			}
+
+			// Returns true if a wide char may fold to the folded char c.
+			static inline bool reached_by_wide(char16_t c) {
+				return c > 0xff || c == u'k' || c == u's' || c == 0xdf || c == 0xe5 || c == 0xff;
+			}
+
+			// Vector version of fold for ASCII and Latin-1. Ranges are below
+			// 0x8000 so signed compares are safe.
+			static inline __m128i fold_sse2(__m128i c) {
+				const __m128i upper = _mm_and_si128(_mm_cmpgt_epi16(c, _mm_set1_epi16(0x40)), _mm_cmplt_epi16(c, _mm_set1_epi16(0x5b)));
+				const __m128i latin = _mm_andnot_si128(_mm_cmpeq_epi16(c, _mm_set1_epi16(0xd7)),
+					_mm_and_si128(_mm_cmpgt_epi16(c, _mm_set1_epi16(0xbf)), _mm_cmplt_epi16(c, _mm_set1_epi16(0xdf))));
+				return _mm_add_epi16(c, _mm_and_si128(_mm_or_si128(upper, latin), _mm_set1_epi16(32)));
+			}
+
+			static inline __m256i fold_avx2(__m256i c) {
+				const __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi16(c, _mm256_set1_epi16(0x40)), _mm256_cmpgt_epi16(_mm256_set1_epi16(0x5b), c));
+				const __m256i latin = _mm256_andnot_si256(_mm256_cmpeq_epi16(c, _mm256_set1_epi16(0xd7)),
+					_mm256_and_si256(_mm256_cmpgt_epi16(c, _mm256_set1_epi16(0xbf)), _mm256_cmpgt_epi16(_mm256_set1_epi16(0xdf), c)));
+				return _mm256_add_epi16(c, _mm256_and_si256(_mm256_or_si256(upper, latin), _mm256_set1_epi16(32)));
+			}
+
+			// Returns a mask of the chars that fold_sse2 does not fold, that is
+			// past U+00FF (unsigned) and U+00B5.
+			static inline __m128i wide_sse2(__m128i c) {
+				const __m128i zero = _mm_setzero_si128();
+				return _mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi16(_mm_subs_epu16(c, _mm_set1_epi16(0xff)), zero), _mm_set1_epi16(-1)),
+					_mm_cmpeq_epi16(c, _mm_set1_epi16(0xb5)));
+			}
+
+			static inline __m256i wide_avx2(__m256i c) {
+				return _mm256_or_si256(_mm256_cmpeq_epi16(_mm256_max_epu16(c, _mm256_set1_epi16(0x100)), c), _mm256_cmpeq_epi16(c, _mm256_set1_epi16(0xb5)));
+			}
+
+			// Returns true if x and y, of n chars, are equal once folded.
+			static inline bool equals_folded(const char16_t* x, const char16_t* y, size_t n) {
+				size_t i = 0;
+				for (; i + 8 <= n; i += 8) {
+					const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(x + i));
+					const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(y + i));
+					const __m128i eq = _mm_cmpeq_epi16(fold_sse2(a), fold_sse2(b));
+					const __m128i wide = _mm_or_si128(wide_sse2(a), wide_sse2(b));
+					if (_mm_movemask_epi8(eq) == 0xffff && _mm_movemask_epi8(wide) == 0) {
+						continue;
+					}
+					for (size_t j = i; j < i + 8; ++j) {
+						if (fold(x[j]) != fold(y[j])) {
+							return false;
+						}
+					}
+				}
+				for (; i < n; ++i) {
+					if (fold(x[i]) != fold(y[i])) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			// Folds n chars of s to out.
+			static inline void fold_copy(const char16_t* s, size_t n, char16_t* out) {
+				size_t i = 0;
+				for (; i + 8 <= n; i += 8) {
+					const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+					if (_mm_movemask_epi8(wide_sse2(c)) == 0) {
+						_mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), fold_sse2(c));
+						continue;
+					}
+					for (size_t j = i; j < i + 8; ++j) {
+						out[j] = fold(s[j]);
+					}
+				}
+				for (; i < n; ++i) {
+					out[i] = fold(s[i]);
+				}
+			}
+
+		} // namespace detail
+
+	} // namespace text
+
+} // namespace circus
@@ -0,0 +1,91 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Helpers of text::fuzzy.
+//
+// advance runs one column of the bit-parallel edit distance of Myers (1999)
+// on a 64-row block, as formulated by Hyyro (2003) for blocks: pv and mv
+// hold the vertical deltas (+1 and -1) of the column, eq the rows whose
+// pattern char matches the text char. The horizontal delta entering the
+// block at the top row comes from the block above (or from row 0: +1 for
+// a global distance, 0 when the pattern may start anywhere in the text)
+// and the one leaving it at the top row of the block is returned.
+//
+// Subsequence scores follow the greedy scheme of fzf v1: a forward scan
+// finds the first window that holds the query in order, a backward scan
+// shrinks it from its end, and matches in the window are scored with
+// bonuses for word boundaries and runs, and penalties for gaps.
+
+
+#pragma once
+
+#include <stdint.h>
+
+namespace circus {
+
+	namespace text {
+
+		namespace detail {
+
+			static inline int advance(uint64_t& pv, uint64_t& mv, uint64_t eq, int hin, uint64_t top) {
+				auto const xv = eq | mv;
+				if (hin < 0) {
+					eq |= 1;
+				}
+				auto const xh = (((eq & pv) + pv) ^ pv) | eq;
+				auto ph = mv | ~(xh | pv);
+				auto mh = pv & xh;
+				auto const hout = (ph & top) != 0 ? 1 : (mh & top) != 0 ? -1 : 0;
+				ph <<= 1;
+				mh <<= 1;
+				if (hin < 0) {
+					mh |= 1;
+				}
+				else if (hin > 0) {
+					ph |= 1;
+				}
+				pv = mh | ~(xv | ph);
+				mv = ph & xv;
+				return hout;
+			}
+
+			// Scores of a subsequence match.
+			static const int score_match = 16;
+			static const int score_gap_start = -3;
+			static const int score_gap_extension = -1;
+			static const int bonus_boundary = 8;
+			static const int bonus_consecutive = 4;
+			static const int bonus_first = 2;
+
+			static inline bool is_alnum(char16_t c) {
+				return c >= 0x80 || (c >= u'0' && c <= u'9') || (c >= u'A' && c <= u'Z') || (c >= u'a' && c <= u'z');
+			}
+
+			// Returns true if p[i] starts a word: the first char, a char after a
+			// separator, or an ASCII upper case letter after a lower case one.
+			static inline bool is_boundary(const char16_t* p, size_t i) {
+				if (i == 0) {
+					return true;
+				}
+				auto const a = p[i - 1], b = p[i];
+				return (!is_alnum(a) && is_alnum(b)) || (a >= u'a' && a <= u'z' && b >= u'A' && b <= u'Z');
+			}
+
+		} // namespace detail
+
+	} // namespace text
+
+} // namespace circus
@@ -0,0 +1,142 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Line break scan of line_index.
+//
+// A unit at c ends a line if it is '\n', or '\r' not followed by '\n', so
+// that a CRLF pair ends a single line at its '\n'. The status of c only
+// depends on c and c + 1, which lets ranges be scanned independently.
+// Kernels compare a block of units and the block shifted by 1 against
+// both chars, 16 or 32 bytes at a time, and append c + 1 for each break.
+
+
+#pragma once
+
+#include <immintrin.h>
+#include <intrin.h>
+#include <stdint.h>
+#include <vector>
+
+#include "../../environment/cpu.h"
+
+namespace circus {
+
+	namespace text {
+
+		namespace detail {
+
+			template <typename T>
+			static inline bool is_break(const T* p, size_t c, size_t n) {
+				return p[c] == '\n' || (p[c] == '\r' && (c + 1 == n || p[c + 1] != '\n'));
+			}
+
+			// Appends (c + 1) << shift for each break c in [i, end) of the n units
+			// of p.
+			template <typename T>
+			static inline void scan_breaks_scalar(const T* p, size_t i, size_t end, size_t n, unsigned shift, std::vector<uint32_t>& out) {
+				for (; i < end; ++i) {
+					if (is_break(p, i, n)) {
+						out.push_back((uint32_t)((i + 1) << shift));
+					}
+				}
+			}
+
+			// Appends the breaks of a movemask, where each unit sets sizeof(T)
+			// bits.
+			template <typename T>
+			static inline void push_breaks(uint32_t mask, size_t i, unsigned shift, std::vector<uint32_t>& out) {
+				if (sizeof(T) == 2) {
+					mask &= 0x55555555;
+				}
+				unsigned long bit;
+				for (; _BitScanForward(&bit, mask); mask &= mask - 1) {
+					out.push_back((uint32_t)((i + bit / sizeof(T) + 1) << shift));
+				}
+			}
+
+			template <typename T>
+			static inline void scan_breaks_sse2(const T* p, size_t i, size_t end, size_t n, unsigned shift, std::vector<uint32_t>& out) {
+				const size_t w = 16 / sizeof(T);
+				const __m128i lf = sizeof(T) == 1 ? _mm_set1_epi8('\n') : _mm_set1_epi16(u'\n');
+				const __m128i cr = sizeof(T) == 1 ? _mm_set1_epi8('\r') : _mm_set1_epi16(u'\r');
+				for (; i + w <= end && i + w < n; i += w) {
+					const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+					const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i + 1));
+					__m128i x, y, z;
+					if (sizeof(T) == 1) {
+						x = _mm_cmpeq_epi8(a, lf);
+						y = _mm_cmpeq_epi8(a, cr);
+						z = _mm_cmpeq_epi8(b, lf);
+					}
+					else {
+						x = _mm_cmpeq_epi16(a, lf);
+						y = _mm_cmpeq_epi16(a, cr);
+						z = _mm_cmpeq_epi16(b, lf);
+					}
+					auto const mask = (uint32_t)_mm_movemask_epi8(_mm_or_si128(x, _mm_andnot_si128(z, y)));
+					if (mask != 0) {
+						push_breaks<T>(mask, i, shift, out);
+					}
+				}
+				scan_breaks_scalar(p, i, end, n, shift, out);
+			}
+
+			template <typename T>
+			static inline void scan_breaks_avx2(const T* p, size_t i, size_t end, size_t n, unsigned shift, std::vector<uint32_t>& out) {
+				const size_t w = 32 / sizeof(T);
+				const __m256i lf = sizeof(T) == 1 ? _mm256_set1_epi8('\n') : _mm256_set1_epi16(u'\n');
+				const __m256i cr = sizeof(T) == 1 ? _mm256_set1_epi8('\r') : _mm256_set1_epi16(u'\r');
+				for (; i + w <= end && i + w < n; i += w) {
+					const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+					const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i + 1));
+					__m256i x, y, z;
+					if (sizeof(T) == 1) {
+						x = _mm256_cmpeq_epi8(a, lf);
+						y = _mm256_cmpeq_epi8(a, cr);
+						z = _mm256_cmpeq_epi8(b, lf);
+					}
+					else {
+						x = _mm256_cmpeq_epi16(a, lf);
+						y = _mm256_cmpeq_epi16(a, cr);
+						z = _mm256_cmpeq_epi16(b, lf);
+					}
+					auto const mask = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(x, _mm256_andnot_si256(z, y)));
+					if (mask != 0) {
+						push_breaks<T>(mask, i, shift, out);
+					}
+				}
+				scan_breaks_sse2(p, i, end, n, shift, out);
+			}
+
+			template <typename T>
+			using breaks_fn = void(*)(const T* p, size_t i, size_t end, size_t n, unsigned shift, std::vector<uint32_t>& out);
+
+			// Kernels are selected once when the library is loaded.
+			template <typename T>
+			static const breaks_fn<T> breaks_kernel = environment::cpu::Avx2() ? scan_breaks_avx2<T> : scan_breaks_sse2<T>;
+
+			// Appends the breaks in [i, end) of the n units of p, shifted left
+			// by shift.
+			template <typename T>
+			static inline void scan_breaks(const T* p, size_t i, size_t end, size_t n, unsigned shift, std::vector<uint32_t>& out) {
+				breaks_kernel<T>(p, i, end, n, shift, out);
+			}
+
+		} // namespace detail
+
+	} // namespace text
+
+} // namespace circus
@@ -0,0 +1,124 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Sorted set intersection of ngram_index posting lists.
+//
+// Lists of similar sizes are intersected 4 by 4 with SSE2: a block of a
+// is compared with the 4 rotations of a block of b, and the block with
+// the smaller last value is skipped, as in Lemire et al. Lists of very
+// different sizes are intersected by galloping: each value of the small
+// list is searched in the large one with an exponential then a binary
+// search from the previous position.
+
+
+#pragma once
+
+#include <algorithm>
+#include <emmintrin.h>
+#include <intrin.h>
+#include <stdint.h>
+
+namespace circus {
+
+	namespace text {
+
+		namespace detail {
+
+			// Above this size ratio, galloping is faster than merging.
+			static const size_t gallop_ratio = 32;
+
+			static inline size_t intersect_scalar(const uint32_t* a, size_t i, size_t na, const uint32_t* b, size_t j, size_t nb, uint32_t* out, size_t k) {
+				while (i < na && j < nb) {
+					if (a[i] < b[j]) {
+						++i;
+					}
+					else if (b[j] < a[i]) {
+						++j;
+					}
+					else {
+						out[k++] = a[i];
+						++i;
+						++j;
+					}
+				}
+				return k;
+			}
+
+			static inline size_t intersect_sse2(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+				size_t i = 0;
+				size_t j = 0;
+				size_t k = 0;
+				while (i + 4 <= na && j + 4 <= nb) {
+					const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+					const __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + j));
+					const __m128i r = _mm_or_si128(
+						_mm_or_si128(_mm_cmpeq_epi32(x, y), _mm_cmpeq_epi32(x, _mm_shuffle_epi32(y, 0x39))),
+						_mm_or_si128(_mm_cmpeq_epi32(x, _mm_shuffle_epi32(y, 0x4e)), _mm_cmpeq_epi32(x, _mm_shuffle_epi32(y, 0x93))));
+					unsigned long bit;
+					for (auto m = (unsigned long)_mm_movemask_ps(_mm_castsi128_ps(r)); _BitScanForward(&bit, m); m &= m - 1) {
+						out[k++] = a[i + bit];
+					}
+					auto const x3 = a[i + 3];
+					auto const y3 = b[j + 3];
+					if (x3 <= y3) {
+						i += 4;
+					}
+					if (y3 <= x3) {
+						j += 4;
+					}
+				}
+				return intersect_scalar(a, i, na, b, j, nb, out, k);
+			}
+
+			// Expects na <= nb.
+			static inline size_t intersect_gallop(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+				size_t j = 0;
+				size_t k = 0;
+				for (size_t i = 0; i < na && j < nb; ++i) {
+					auto const v = a[i];
+					size_t step = 1;
+					auto hi = j;
+					while (hi < nb && b[hi] < v) {
+						j = hi + 1;
+						hi += step;
+						step <<= 1;
+					}
+					j = (size_t)(std::lower_bound(b + j, b + std::min(hi + 1, nb), v) - b);
+					if (j < nb && b[j] == v) {
+						out[k++] = v;
+						++j;
+					}
+				}
+				return k;
+			}
+
+			// Writes the values of both sorted lists to out, which may be a, and
+			// returns their number.
+			static inline size_t intersect(const uint32_t* a, size_t na, const uint32_t* b, size_t nb, uint32_t* out) {
+				if (na * gallop_ratio < nb) {
+					return intersect_gallop(a, na, b, nb, out);
+				}
+				if (nb * gallop_ratio < na) {
+					return intersect_gallop(b, nb, a, na, out);
+				}
+				return intersect_sse2(a, na, b, nb, out);
+			}
+
+		} // namespace detail
+
+	} // namespace text
+
+} // namespace circus
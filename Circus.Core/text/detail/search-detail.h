@@ -0,0 +1,313 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#pragma once
+
+#include <immintrin.h>
+#include <intrin.h>
+#include <string.h>
+
+#include "../../environment/cpu.h"
+#include "fold-detail.h"
+
+namespace circus {
+
+	namespace text {
+
+		namespace detail {
+
+			// Vectorized substring search over char16_t buffers.
+			//
+			// Each block compares the first and the last needle chars against
+			// 8 (SSE2) or 16 (AVX2) consecutive candidate positions at once.
+			// Only positions where both match are verified with memcmp, which
+			// filters out almost every false candidate on real text. Remaining
+			// positions that do not fill a block are checked one by one.
+			//
+			// All functions expect 0 < n <= size and return the offset of the
+			// match in h, or size_t(-1) if not found.
+
+			static constexpr size_t npos = size_t(-1);
+
+			typedef size_t(*search_fn)(const char16_t* h, size_t size, const char16_t* s, size_t n);
+
+			static inline bool verify(const char16_t* h, const char16_t* s, size_t n) {
+				return n < 3 || memcmp(h + 1, s + 1, (n - 2) * sizeof(char16_t)) == 0;
+			}
+
+			static inline size_t find_scalar(const char16_t* h, size_t i, size_t end, const char16_t* s, size_t n) {
+				auto const first = s[0];
+				auto const last = s[n - 1];
+				for (; i < end; ++i) {
+					if (h[i] == first && h[i + n - 1] == last && verify(h + i, s, n)) {
+						return i;
+					}
+				}
+				return npos;
+			}
+
+			static inline size_t rfind_scalar(const char16_t* h, size_t end, const char16_t* s, size_t n) {
+				auto const first = s[0];
+				auto const last = s[n - 1];
+				while (end-- > 0) {
+					if (h[end] == first && h[end + n - 1] == last && verify(h + end, s, n)) {
+						return end;
+					}
+				}
+				return npos;
+			}
+
+			static inline size_t find_sse2(const char16_t* h, size_t size, const char16_t* s, size_t n) {
+				const __m128i first = _mm_set1_epi16((short)s[0]);
+				const __m128i last = _mm_set1_epi16((short)s[n - 1]);
+				auto const end = size - n + 1;
+				size_t i = 0;
+				for (; i + 8 <= end; i += 8) {
+					const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i));
+					const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i + n - 1));
+					unsigned long mask = (unsigned long)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(a, first), _mm_cmpeq_epi16(b, last)));
+					unsigned long bit;
+					while (_BitScanForward(&bit, mask)) {
+
+						// Each char sets 2 bits in the mask.
+						auto const j = i + (bit >> 1);
+						if (verify(h + j, s, n)) {
+							return j;
+						}
+						mask &= ~(3ul << bit);
+					}
+				}
+				return find_scalar(h, i, end, s, n);
+			}
+
+			static inline size_t find_avx2(const char16_t* h, size_t size, const char16_t* s, size_t n) {
+				const __m256i first = _mm256_set1_epi16((short)s[0]);
+				const __m256i last = _mm256_set1_epi16((short)s[n - 1]);
+				auto const end = size - n + 1;
+				size_t i = 0;
+				for (; i + 16 <= end; i += 16) {
+					const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i));
+					const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i + n - 1));
+					unsigned long mask = (unsigned long)(unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi16(a, first), _mm256_cmpeq_epi16(b, last)));
+					unsigned long bit;
+					while (_BitScanForward(&bit, mask)) {
+						auto const j = i + (bit >> 1);
+						if (verify(h + j, s, n)) {
+							return j;
+						}
+						mask &= ~(3ul << bit);
+					}
+				}
+				if (i + 8 <= end) {
+					auto const r = find_sse2(h + i, size - i, s, n);
+					return r == npos ? npos : i + r;
+				}
+				return find_scalar(h, i, end, s, n);
+			}
+
+			// Last occurrence where the match starts at or before pos.
+			static inline size_t rfind_sse2(const char16_t* h, size_t size, size_t pos, const char16_t* s, size_t n) {
+				const __m128i first = _mm_set1_epi16((short)s[0]);
+				const __m128i last = _mm_set1_epi16((short)s[n - 1]);
+				auto i = (pos < size - n ? pos : size - n) + 1;
+				for (; i >= 8; i -= 8) {
+					auto const k = i - 8;
+					const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + k));
+					const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + k + n - 1));
+					unsigned long mask = (unsigned long)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi16(a, first), _mm_cmpeq_epi16(b, last)));
+					unsigned long bit;
+					while (_BitScanReverse(&bit, mask)) {
+						auto const j = k + (bit >> 1);
+						if (verify(h + j, s, n)) {
+							return j;
+						}
+						mask &= ~(3ul << (bit - 1));
+					}
+				}
+				return rfind_scalar(h, i, s, n);
+			}
+
+			static inline size_t rfind_avx2(const char16_t* h, size_t size, size_t pos, const char16_t* s, size_t n) {
+				const __m256i first = _mm256_set1_epi16((short)s[0]);
+				const __m256i last = _mm256_set1_epi16((short)s[n - 1]);
+				auto i = (pos < size - n ? pos : size - n) + 1;
+				for (; i >= 16; i -= 16) {
+					auto const k = i - 16;
+					const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + k));
+					const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + k + n - 1));
+					unsigned long mask = (unsigned long)(unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi16(a, first), _mm256_cmpeq_epi16(b, last)));
+					unsigned long bit;
+					while (_BitScanReverse(&bit, mask)) {
+						auto const j = k + (bit >> 1);
+						if (verify(h + j, s, n)) {
+							return j;
+						}
+						mask &= ~(3ul << (bit - 1));
+					}
+				}
+				return i >= 8 ? rfind_sse2(h, size, i - 1, s, n) : rfind_scalar(h, i, s, n);
+			}
+
+			// Folded variants expect s to be folded already and fold h on the fly.
+			static inline bool verify_folded(const char16_t* h, const char16_t* s, size_t n) {
+				for (size_t j = 1; j + 1 < n; ++j) {
+					if (fold(h[j]) != s[j]) {
+						return false;
+					}
+				}
+				return true;
+			}
+
+			static inline size_t find_folded_scalar(const char16_t* h, size_t i, size_t end, const char16_t* s, size_t n) {
+				auto const first = s[0];
+				auto const last = s[n - 1];
+				for (; i < end; ++i) {
+					if (fold(h[i]) == first && fold(h[i + n - 1]) == last && verify_folded(h + i, s, n)) {
+						return i;
+					}
+				}
+				return npos;
+			}
+
+			// Candidates of the vector variants also include positions where the
+			// first or last char is wide, when a wide char may fold to the first
+			// or last char of s. Both ends are checked again with fold.
+			static inline bool verify_folded_ends(const char16_t* h, const char16_t* s, size_t n) {
+				return fold(h[0]) == s[0] && fold(h[n - 1]) == s[n - 1] && verify_folded(h, s, n);
+			}
+
+			static inline size_t find_folded_sse2(const char16_t* h, size_t size, const char16_t* s, size_t n) {
+				const __m128i first = _mm_set1_epi16((short)s[0]);
+				const __m128i last = _mm_set1_epi16((short)s[n - 1]);
+				const __m128i wide_first = _mm_set1_epi16(reached_by_wide(s[0]) ? -1 : 0);
+				const __m128i wide_last = _mm_set1_epi16(reached_by_wide(s[n - 1]) ? -1 : 0);
+				auto const end = size - n + 1;
+				size_t i = 0;
+				for (; i + 8 <= end; i += 8) {
+					const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i));
+					const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i + n - 1));
+					const __m128i x = _mm_or_si128(_mm_cmpeq_epi16(fold_sse2(a), first), _mm_and_si128(wide_sse2(a), wide_first));
+					const __m128i y = _mm_or_si128(_mm_cmpeq_epi16(fold_sse2(b), last), _mm_and_si128(wide_sse2(b), wide_last));
+					unsigned long mask = (unsigned long)_mm_movemask_epi8(_mm_and_si128(x, y));
+					unsigned long bit;
+					while (_BitScanForward(&bit, mask)) {
+						auto const j = i + (bit >> 1);
+						if (verify_folded_ends(h + j, s, n)) {
+							return j;
+						}
+						mask &= ~(3ul << bit);
+					}
+				}
+				return find_folded_scalar(h, i, end, s, n);
+			}
+
+			static inline size_t find_folded_avx2(const char16_t* h, size_t size, const char16_t* s, size_t n) {
+				const __m256i first = _mm256_set1_epi16((short)s[0]);
+				const __m256i last = _mm256_set1_epi16((short)s[n - 1]);
+				const __m256i wide_first = _mm256_set1_epi16(reached_by_wide(s[0]) ? -1 : 0);
+				const __m256i wide_last = _mm256_set1_epi16(reached_by_wide(s[n - 1]) ? -1 : 0);
+				auto const end = size - n + 1;
+				size_t i = 0;
+				for (; i + 16 <= end; i += 16) {
+					const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i));
+					const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i + n - 1));
+					const __m256i x = _mm256_or_si256(_mm256_cmpeq_epi16(fold_avx2(a), first), _mm256_and_si256(wide_avx2(a), wide_first));
+					const __m256i y = _mm256_or_si256(_mm256_cmpeq_epi16(fold_avx2(b), last), _mm256_and_si256(wide_avx2(b), wide_last));
+					unsigned long mask = (unsigned long)(unsigned)_mm256_movemask_epi8(_mm256_and_si256(x, y));
+					unsigned long bit;
+					while (_BitScanForward(&bit, mask)) {
+						auto const j = i + (bit >> 1);
+						if (verify_folded_ends(h + j, s, n)) {
+							return j;
+						}
+						mask &= ~(3ul << bit);
+					}
+				}
+				if (i + 8 <= end) {
+					auto const r = find_folded_sse2(h + i, size - i, s, n);
+					return r == npos ? npos : i + r;
+				}
+				return find_folded_scalar(h, i, end, s, n);
+			}
+
+			// Byte variants, for 8-bit text such as UTF-8 files, compare 16 or 32
+			// positions per block.
+			typedef size_t(*bytes_search_fn)(const char* h, size_t size, const char* s, size_t n);
+
+			static inline size_t find_bytes_scalar(const char* h, size_t i, size_t end, const char* s, size_t n) {
+				for (; i < end; ++i) {
+					if (h[i] == s[0] && h[i + n - 1] == s[n - 1] && (n < 3 || memcmp(h + i + 1, s + 1, n - 2) == 0)) {
+						return i;
+					}
+				}
+				return npos;
+			}
+
+			static inline size_t find_bytes_sse2(const char* h, size_t size, const char* s, size_t n) {
+				const __m128i first = _mm_set1_epi8(s[0]);
+				const __m128i last = _mm_set1_epi8(s[n - 1]);
+				auto const end = size - n + 1;
+				size_t i = 0;
+				for (; i + 16 <= end; i += 16) {
+					const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i));
+					const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(h + i + n - 1));
+					unsigned long mask = (unsigned long)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+					unsigned long bit;
+					for (; _BitScanForward(&bit, mask); mask &= mask - 1) {
+						if (n < 3 || memcmp(h + i + bit + 1, s + 1, n - 2) == 0) {
+							return i + bit;
+						}
+					}
+				}
+				return find_bytes_scalar(h, i, end, s, n);
+			}
+
+			static inline size_t find_bytes_avx2(const char* h, size_t size, const char* s, size_t n) {
+				const __m256i first = _mm256_set1_epi8(s[0]);
+				const __m256i last = _mm256_set1_epi8(s[n - 1]);
+				auto const end = size - n + 1;
+				size_t i = 0;
+				for (; i + 32 <= end; i += 32) {
+					const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i));
+					const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(h + i + n - 1));
+					unsigned long mask = (unsigned long)(unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+					unsigned long bit;
+					for (; _BitScanForward(&bit, mask); mask &= mask - 1) {
+						if (n < 3 || memcmp(h + i + bit + 1, s + 1, n - 2) == 0) {
+							return i + bit;
+						}
+					}
+				}
+				if (i + 16 <= end) {
+					auto const r = find_bytes_sse2(h + i, size - i, s, n);
+					return r == npos ? npos : i + r;
+				}
+				return find_bytes_scalar(h, i, end, s, n);
+			}
+
+			typedef size_t(*rsearch_fn)(const char16_t* h, size_t size, size_t pos, const char16_t* s, size_t n);
+
+			// Kernels are selected once when the library is loaded.
+			static const search_fn find_kernel = environment::cpu::Avx2() ? find_avx2 : find_sse2;
+			static const rsearch_fn rfind_kernel = environment::cpu::Avx2() ? rfind_avx2 : rfind_sse2;
+			static const search_fn find_folded_kernel = environment::cpu::Avx2() ? find_folded_avx2 : find_folded_sse2;
+			static const bytes_search_fn find_bytes_kernel = environment::cpu::Avx2() ? find_bytes_avx2 : find_bytes_sse2;
+
+		} // namespace detail
+
+	} // namespace text
+
+} // namespace circus
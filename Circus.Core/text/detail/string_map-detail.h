@@ -0,0 +1,66 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Control bytes of string_map.
+//
+// Each slot has a control byte: empty, deleted, or the 7 low bits of the
+// hash of its key when full. Slots are grouped by 16 so that a group is
+// matched against a control value with one SSE2 compare.
+
+
+#pragma once
+
+#include <emmintrin.h>
+#include <stdint.h>
+
+namespace circus {
+
+	namespace text {
+
+		namespace detail {
+
+			static const int8_t ctrl_empty = -128;
+			static const int8_t ctrl_deleted = -2;
+			static const size_t group_width = 16;
+
+			struct ctrl_group {
+				__m128i ctrl;
+
+				explicit ctrl_group(const int8_t* p) : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {
+				}
+
+				// Returns a bit per slot whose control byte is h2.
+				uint32_t match(int8_t h2) const {
+					return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+				}
+
+				// Returns a bit per empty slot.
+				uint32_t match_empty() const {
+					return match(ctrl_empty);
+				}
+
+				// Returns a bit per empty or deleted slot, the only ones with the
+				// high bit set.
+				uint32_t match_free() const {
+					return (uint32_t)_mm_movemask_epi8(ctrl);
+				}
+			};
+
+		} // namespace detail
+
+	} // namespace text
+
+} // namespace circus
@@ -0,0 +1,212 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Searches a file for a value without loading it in managed memory.
+//
+// Reading a large file into a managed string doubles memory and copies
+// the text twice before the first search. search_file maps the file in
+// the address space instead and scans the mapped pages in place, so the
+// file is read once and shared with the system cache.
+//
+// The file is split into chunks of about 4M units ending on a '\n', and
+// the chunks are scanned in parallel with the vectorized kernels of
+// basic_string::find (see detail/search-detail.h). Files with a UTF-16LE
+// byte order mark are searched as char16_t; other files are searched as
+// bytes for the UTF-8 encoding of the value, which also matches ASCII
+// values in any 8-bit encoding. Every occurrence is reported, including
+// overlapping ones, since a chunk only knows the matches that start in
+// it.
+//
+// Matches are reported as (line, offset) records, where line is the
+// 0-based number of '\n' before the match and offset is its byte offset
+// in the file. The caller thread delivers the records of each chunk in
+// file order through a callback, along with the number of bytes scanned,
+// and the search stops as soon as the callback returns false. Workers do
+// not run more than 2 chunks per worker ahead of the callback, which
+// bounds the memory held by undelivered records.
+
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "basic_string_view.h"
+#include "detail/file_search-detail.h"
+#include "detail/search-detail.h"
+
+namespace circus {
+
+	namespace text {
+
+		// Receives the (line, offset) records of a chunk and the number of
+		// bytes scanned so far. Returns false to cancel the search.
+		typedef BOOL(*file_search_callback)(const int64_t* records, int count, int64_t position, void* state);
+
+		namespace detail {
+
+			static const size_t file_chunk_units = 1 << 22;
+
+			struct file_chunk {
+				std::vector<int64_t> records;
+				int64_t lines;
+				bool done;
+			};
+
+			// Returns the chunk boundaries of [first, size), each chunk ending
+			// after the first '\n' past file_chunk_units units, or after twice
+			// that size on very long lines.
+			template <typename T>
+			static inline std::vector<size_t> split_lines(const T* p, size_t first, size_t size) {
+				std::vector<size_t> r(1, first);
+				while (r.back() < size) {
+					auto e = r.back() + file_chunk_units;
+					if (e >= size) {
+						e = size;
+					}
+					else {
+						auto const stop = std::min(e + file_chunk_units, size);
+						while (e < stop && p[e - 1] != '\n') {
+							++e;
+						}
+					}
+					r.push_back(e);
+				}
+				return r;
+			}
+
+			// Scans the matches starting in [first, last) and the number of '\n'
+			// in the chunk. Matches may end past the chunk.
+			template <typename T, typename K>
+			static inline void scan_chunk(const T* p, size_t size, size_t first, size_t last, const T* s, size_t n, K kernel, file_chunk& chunk) {
+				auto const limit = std::min(last + n - 1, size);
+				auto pos = first;
+				auto from = first;
+				int64_t line = 0;
+				while (limit - pos >= n) {
+					auto const r = kernel(p + pos, limit - pos, s, n);
+					if (r == npos) {
+						break;
+					}
+					auto const j = pos + r;
+					line += (int64_t)count_lines(p + from, j - from);
+					from = j;
+					chunk.records.push_back(line);
+					chunk.records.push_back((int64_t)(j * sizeof(T)));
+					pos = j + 1;
+				}
+				chunk.lines = line + (int64_t)count_lines(p + from, last - from);
+			}
+
+			template <typename T, typename K>
+			static inline int64_t search_units(const T* p, size_t first, size_t size, const T* s, size_t n, K kernel, file_search_callback f, void* state) {
+				auto const bounds = split_lines(p, first, size);
+				auto const count = bounds.size() - 1;
+				std::vector<file_chunk> chunks(count, file_chunk{ std::vector<int64_t>(), 0, false });
+				auto const workers = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), count);
+				auto const window = workers * 2;
+				std::mutex m;
+				std::condition_variable ready;
+				std::condition_variable room;
+				size_t next = 0;
+				size_t delivered = 0;
+				bool stop = false;
+				auto const work = [&]() {
+					for (;;) {
+						size_t i;
+						{
+							std::unique_lock<std::mutex> lock(m);
+							room.wait(lock, [&]() { return stop || next >= count || next < delivered + window; });
+							if (stop || next >= count) {
+								return;
+							}
+							i = next++;
+						}
+						file_chunk chunk{ std::vector<int64_t>(), 0, true };
+						scan_chunk(p, size, bounds[i], bounds[i + 1], s, n, kernel, chunk);
+						{
+							std::lock_guard<std::mutex> lock(m);
+							chunks[i] = std::move(chunk);
+						}
+						ready.notify_one();
+					}
+				};
+				std::vector<std::thread> threads;
+				threads.reserve(workers);
+				for (size_t i = 0; i < workers; ++i) {
+					threads.emplace_back(work);
+				}
+				int64_t total = 0;
+				int64_t base = 0;
+				for (size_t i = 0; i < count; ++i) {
+					std::vector<int64_t> records;
+					int64_t lines;
+					{
+						std::unique_lock<std::mutex> lock(m);
+						ready.wait(lock, [&]() { return chunks[i].done; });
+						records.swap(chunks[i].records);
+						lines = chunks[i].lines;
+					}
+					for (size_t k = 0; k < records.size(); k += 2) {
+						records[k] += base;
+					}
+					base += lines;
+					total += (int64_t)(records.size() / 2);
+					auto const go = f(records.data(), (int)(records.size() / 2), (int64_t)(bounds[i + 1] * sizeof(T)), state) != 0;
+					{
+						std::lock_guard<std::mutex> lock(m);
+						delivered = i + 1;
+						stop = !go;
+					}
+					room.notify_all();
+					if (!go) {
+						break;
+					}
+				}
+				for (auto& t : threads) {
+					t.join();
+				}
+				return total;
+			}
+
+		} // namespace detail
+
+		// Reports the occurrences of value in the file at path, a
+		// null-terminated string, to f. Returns the number of occurrences
+		// reported, or -1 if the file cannot be read.
+		inline int64_t search_file(const char16_t* path, const basic_string_view& value, file_search_callback f, void* state) {
+			detail::mapped_file file(path);
+			if (!file.opened()) {
+				return -1;
+			}
+			auto const p = file.data();
+			auto const size = file.size();
+			if (size >= 2 && (uint8_t)p[0] == 0xff && (uint8_t)p[1] == 0xfe) {
+				auto const units = reinterpret_cast<const char16_t*>(p);
+				return value.size() > size / 2 - 1 ? 0 : detail::search_units(units, 1, size / 2, value.data(), value.size(), detail::find_kernel, f, state);
+			}
+			auto const s = detail::utf8(value.data(), value.size());
+			return s.size() > size ? 0 : detail::search_units(p, 0, size, s.data(), s.size(), detail::find_bytes_kernel, f, state);
+		}
+
+	} // namespace text
+
+} // namespace circus
@@ -0,0 +1,340 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// A precompiled query for approximate matching.
+//
+// distance is the Levenshtein distance between the query and a string,
+// and search the smallest distance between the query and any substring
+// of a string, that is the number of typos of the best occurrence. Both
+// use the bit-parallel algorithm of Myers: a column of the dynamic
+// programming matrix is held in 2 bit-vectors of the query length and
+// updated in a few word operations per char of the string. Queries up to
+// 64 chars fit in a single word; longer ones run on blocks of 64 (see
+// detail/fuzzy-detail.h). distance stops as soon as the last row cannot
+// come back under the k limit, search as soon as an exact occurrence is
+// found.
+//
+// The match masks of the query chars are built once: a table for ASCII
+// and a sorted list for the other chars. Chars are compared after
+// detail::fold when fold is set; the ASCII table holds both cases so
+// that ASCII chars of the string are not folded.
+//
+// score rates the query as a subsequence of a string, for ranking typed
+// abbreviations (i.e. "fbr" in "FooBar"), or returns -1 if the query chars
+// do not all appear in order.
+//
+// match scores a query against a column of candidates held in a blob with
+// offsets, split across threads for large columns like batch hashes, and
+// outputs the top candidates within k typos, by distance, then score,
+// then index.
+
+
+#pragma once
+
+#include <algorithm>
+#include <limits.h>
+#include <mutex>
+#include <stdint.h>
+#include <vector>
+
+#include "../hash/farmhash.h"
+#include "basic_string_view.h"
+#include "detail/fold-detail.h"
+#include "detail/fuzzy-detail.h"
+
+namespace circus {
+
+	namespace text {
+
+		class fuzzy {
+		public:
+
+			// Types
+			typedef char16_t value_type;
+			typedef size_t size_type;
+
+		public:
+			fuzzy() = delete;
+
+			fuzzy(const value_type* s, size_type n, bool fold) : words_((n + 63) / 64), fold_(fold) {
+				init(s, n);
+			}
+
+			// Returns the Levenshtein distance between the query and str, or -1
+			// if it is greater than k.
+			int distance(const basic_string_view& str, int k) const {
+				return run(str, k, 1);
+			}
+
+			// Returns the smallest distance between the query and a substring of
+			// str, or -1 if it is greater than k.
+			int search(const basic_string_view& str, int k) const {
+				return run(str, k, 0);
+			}
+
+			// Returns the score of the query as a subsequence of str, or -1 if
+			// it is not one.
+			inline int score(const basic_string_view& str) const;
+
+			size_type size() const {
+				return query_.size();
+			}
+
+			// Outputs to indices and distances the top candidates of blob, at
+			// offsets (count + 1 of them), within k typos of the query. Returns
+			// the number of candidates written.
+			inline size_type match(const value_type* blob, const int* offsets, size_type count, int k, int* indices, int* distances, size_type top) const;
+
+		private:
+			value_type at(value_type c) const {
+				return fold_ ? detail::fold(c) : c;
+			}
+
+			inline const uint64_t* eq(value_type c) const;
+			inline void init(const value_type* s, size_type n);
+			inline int run(const basic_string_view& str, int k, int hin) const;
+			inline int run_word(const basic_string_view& str, int k, int hin) const;
+
+		private:
+			std::vector<value_type> query_;
+			std::vector<uint64_t> ascii_;
+			std::vector<value_type> wide_;
+			std::vector<uint64_t> masks_;
+			const size_type words_;
+			const bool fold_;
+		};
+
+		// Returns the match masks of c, folded if required, words_ of them.
+		inline const uint64_t* fuzzy::eq(value_type c) const {
+			if (c < 128) {
+				return ascii_.data() + c * words_;
+			}
+			auto const i = std::lower_bound(wide_.begin(), wide_.end(), c);
+			auto const j = i != wide_.end() && *i == c ? (size_type)(i - wide_.begin()) : wide_.size() - 1;
+			return masks_.data() + j * words_;
+		}
+
+		inline void fuzzy::init(const value_type* s, size_type n) {
+			query_.resize(n);
+			ascii_.assign(128 * words_, 0);
+			for (size_type i = 0; i < n; ++i) {
+				query_[i] = at(s[i]);
+				if (query_[i] >= 128) {
+					wide_.push_back(query_[i]);
+				}
+			}
+			std::sort(wide_.begin(), wide_.end());
+			wide_.erase(std::unique(wide_.begin(), wide_.end()), wide_.end());
+
+			// The last entry is the empty mask of the chars that are not in the
+			// query. U+FFFF is a noncharacter so it never shadows a query char.
+			wide_.push_back(0xffff);
+			masks_.assign(wide_.size() * words_, 0);
+			for (size_type i = 0; i < n; ++i) {
+				auto const c = query_[i];
+				auto const bit = 1ull << (i & 63);
+				if (c < 128) {
+					ascii_[c * words_ + i / 64] |= bit;
+
+					// ASCII chars of the string are looked up as is.
+					if (fold_ && c >= u'a' && c <= u'z') {
+						ascii_[(c - 32) * words_ + i / 64] |= bit;
+					}
+				}
+				else {
+					auto const j = (size_type)(std::lower_bound(wide_.begin(), wide_.end() - 1, c) - wide_.begin());
+					masks_[j * words_ + i / 64] |= bit;
+				}
+			}
+		}
+
+		inline typename fuzzy::size_type
+			fuzzy::match(const value_type* blob, const int* offsets, size_type count, int k, int* indices, int* distances, size_type top) const {
+			if (top == 0) {
+				return 0;
+			}
+
+			// Keys order candidates by distance, then score (inverted), then
+			// index, in 16, 16 and 32 bits.
+			std::vector<uint64_t> keys;
+			std::mutex lock;
+			farmhash::detail::ForEachRange(offsets, count, [&](size_t first, size_t last) {
+				std::vector<uint64_t> heap;
+				for (auto i = first; i < last; ++i) {
+					const basic_string_view str(blob + offsets[i], offsets[i + 1] - offsets[i]);
+					auto const d = search(str, k);
+					if (d < 0) {
+						continue;
+					}
+					auto const s = std::min(std::max(score(str), 0), 0xffff);
+					auto const key = ((uint64_t)d << 48) | ((uint64_t)(0xffff - s) << 32) | (uint64_t)i;
+					if (heap.size() < top) {
+						heap.push_back(key);
+						std::push_heap(heap.begin(), heap.end());
+					}
+					else if (key < heap.front()) {
+						std::pop_heap(heap.begin(), heap.end());
+						heap.back() = key;
+						std::push_heap(heap.begin(), heap.end());
+					}
+				}
+				std::lock_guard<std::mutex> guard(lock);
+				keys.insert(keys.end(), heap.begin(), heap.end());
+			});
+			auto const n = std::min(top, keys.size());
+			std::partial_sort(keys.begin(), keys.begin() + n, keys.end());
+			for (size_type i = 0; i < n; ++i) {
+				indices[i] = (int)(keys[i] & 0xffffffff);
+				if (distances != nullptr) {
+					distances[i] = (int)(keys[i] >> 48);
+				}
+			}
+			return n;
+		}
+
+		// Runs the columns of str over the query. hin is the horizontal delta
+		// of row 0: 1 for a distance, 0 for a search.
+		inline int fuzzy::run(const basic_string_view& str, int k, int hin) const {
+			auto const m = (int)size();
+			auto const n = (int)str.size();
+			if (k < 0) {
+				k = INT_MAX;
+			}
+			if (m == 0) {
+				auto const d = hin != 0 ? n : 0;
+				return d <= k ? d : -1;
+			}
+			if (hin != 0 && (m > n ? m - n : n - m) > k) {
+				return -1;
+			}
+
+			// Vertical deltas start at +1 on every row: D[i][0] = i.
+			if (words_ == 1) {
+				return run_word(str, k, hin);
+			}
+			uint64_t stack[8];
+			std::vector<uint64_t> heap(words_ > 4 ? 2 * words_ : 0);
+			auto const pv = words_ > 4 ? heap.data() : stack;
+			auto const mv = pv + words_;
+			std::fill(pv, pv + words_, ~0ull);
+			std::fill(mv, mv + words_, 0ull);
+			auto const top = 1ull << ((m - 1) & 63);
+			auto score = m, best = m;
+			for (int j = 0; j < n; ++j) {
+				auto const c = str[j];
+				auto const e = c < 128 ? ascii_.data() + c * words_ : eq(at(c));
+				auto h = hin;
+				for (size_type w = 0; w + 1 < words_; ++w) {
+					h = detail::advance(pv[w], mv[w], e[w], h, 1ull << 63);
+				}
+				score += detail::advance(pv[words_ - 1], mv[words_ - 1], e[words_ - 1], h, top);
+				if (hin != 0) {
+
+					// The last row drops by 1 at most per char left.
+					if (score - (n - j - 1) > k) {
+						return -1;
+					}
+				}
+				else if (score < best) {
+					best = score;
+					if (best == 0) {
+						break;
+					}
+				}
+			}
+			auto const d = hin != 0 ? score : best;
+			return d <= k ? d : -1;
+		}
+
+		// Single word variant of run, for queries up to 64 chars.
+		inline int fuzzy::run_word(const basic_string_view& str, int k, int hin) const {
+			auto const m = (int)size();
+			auto const n = (int)str.size();
+			auto const top = 1ull << (m - 1);
+			uint64_t pv = ~0ull, mv = 0;
+			auto score = m, best = m;
+			for (int j = 0; j < n; ++j) {
+				auto const c = str[j];
+				score += detail::advance(pv, mv, c < 128 ? ascii_[c] : *eq(at(c)), hin, top);
+				if (hin != 0) {
+					if (score - (n - j - 1) > k) {
+						return -1;
+					}
+				}
+				else if (score < best) {
+					best = score;
+					if (best == 0) {
+						break;
+					}
+				}
+			}
+			auto const d = hin != 0 ? score : best;
+			return d <= k ? d : -1;
+		}
+
+		inline int fuzzy::score(const basic_string_view& str) const {
+			auto const m = size();
+			auto const n = str.size();
+			if (m == 0) {
+				return 0;
+			}
+
+			// First window that holds the query in order.
+			size_type q = 0, end = 0;
+			for (; end < n; ++end) {
+				if (at(str[end]) == query_[q] && ++q == m) {
+					break;
+				}
+			}
+			if (q < m) {
+				return -1;
+			}
+
+			// Shrinks it from its end.
+			auto start = end;
+			for (q = m - 1;; --start) {
+				if (at(str[start]) == query_[q]) {
+					if (q == 0) {
+						break;
+					}
+					--q;
+				}
+			}
+			int s = 0, run = 0, gap = 0;
+			q = 0;
+			for (auto i = start; i <= end; ++i) {
+				if (q < m && at(str[i]) == query_[q]) {
+					auto bonus = detail::is_boundary(str.data(), i) ? detail::bonus_boundary : 0;
+					if (run > 0) {
+						bonus = std::max(bonus, detail::bonus_consecutive);
+					}
+					s += detail::score_match + (q == 0 ? bonus * detail::bonus_first : bonus);
+					++run;
+					++q;
+					gap = 0;
+				}
+				else {
+					s += gap == 0 ? detail::score_gap_start : detail::score_gap_extension;
+					++gap;
+					run = 0;
+				}
+			}
+			return std::max(s, 0);
+		}
+
+	} // namespace text
+
+} // namespace circus
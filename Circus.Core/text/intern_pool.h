@@ -0,0 +1,240 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// A pool of distinct UTF-16 strings with stable 32-bit ids.
+//
+// Hashing the same keys on every lookup repeats the same work. The pool
+// interns each distinct string once: its chars are copied to an
+// append-only arena and its 64-bit hash, with the per-process seed used
+// for string keys of Map, is cached with its size in an entry. An id is
+// the index of the entry, so the hash, size and chars of an id are O(1)
+// and 2 interned strings are equal if their ids are.
+//
+// Neither chars nor entries ever move: the arena grows by blocks and the
+// entries live in pages of 64K allocated on demand, so a pointer or an id
+// stays valid for the lifetime of the pool. Strings are found with an
+// open addressing table of 64-bit slots holding the id and the high 32
+// bits of the hash, probed linearly with a load below 3/4.
+//
+// Readers are lock-free: find only performs acquire loads of the table,
+// of its slots and of the entry pages. Writers are serialized by a mutex.
+// A writer publishes the entry before the slot that points to it, and a
+// grown table after it is filled; older tables are kept until the pool is
+// destroyed since readers may still probe them, which holds at most as
+// many slots as the current table. A reader racing with intern may miss
+// the new string, in which case intern looks again under the lock.
+
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "../hash/farmhash.h"
+#include "basic_string_view.h"
+
+namespace circus {
+
+	namespace text {
+
+		class intern_pool {
+		public:
+
+			// Types
+			typedef char16_t value_type;
+			typedef size_t size_type;
+			typedef uint32_t id_type;
+			static constexpr id_type npos = id_type(-1);
+
+		public:
+			intern_pool(const intern_pool& intern_pool) = delete;
+
+			intern_pool() : pages_(new std::atomic<entry*>[page_count]()), cursor_(nullptr), left_(0), count_(0) {
+				tables_.emplace_back(new table(16));
+				table_.store(tables_.back().get(), std::memory_order_release);
+			}
+
+			~intern_pool() {
+				for (size_type i = 0; i < page_count; ++i) {
+					delete[] pages_[i].load(std::memory_order_relaxed);
+				}
+			}
+
+			intern_pool& operator=(const intern_pool& intern_pool) = delete;
+
+			// Returns the number of interned strings.
+			size_type count() const {
+				return count_.load(std::memory_order_acquire);
+			}
+
+			const value_type* data(id_type id) const {
+				return at(id).data;
+			}
+
+			// Returns the id of str, or npos if it is not interned.
+			id_type find(const basic_string_view& str) const {
+				return find(str, hash(str));
+			}
+
+			uint64_t hash(id_type id) const {
+				return at(id).hash;
+			}
+
+			// Returns the id of str, interning it first if needed, or npos if
+			// the pool is full.
+			inline id_type intern(const basic_string_view& str);
+
+			size_type size(id_type id) const {
+				return at(id).size;
+			}
+
+		private:
+			struct entry {
+				uint64_t hash;
+				const value_type* data;
+				uint32_t size;
+			};
+
+			struct table {
+				explicit table(size_type n) : mask(n - 1), slots(new std::atomic<uint64_t>[n]()) {
+				}
+
+				const size_type mask;
+				const std::unique_ptr<std::atomic<uint64_t>[]> slots;
+			};
+
+			static const size_type page_bits = 16;
+			static const size_type page_count = size_type(1) << (32 - page_bits);
+			static const size_type block_size = 1 << 16;
+
+			const entry& at(id_type id) const {
+				return pages_[id >> page_bits].load(std::memory_order_acquire)[id & ((1 << page_bits) - 1)];
+			}
+
+			inline const value_type* copy(const basic_string_view& str);
+			inline id_type find(const basic_string_view& str, uint64_t h) const;
+
+			static uint64_t hash(const basic_string_view& str) {
+				return farmhash::hash64_local(str.data(), str.size(), farmhash::seed);
+			}
+
+			inline void insert(table& t, id_type id, uint64_t h);
+
+			// A slot holds id + 1 in its low bits, so that 0 is empty.
+			static uint64_t slot(id_type id, uint64_t h) {
+				return (h & 0xffffffff00000000ull) | ((uint64_t)id + 1);
+			}
+
+		private:
+			std::atomic<table*> table_;
+			std::vector<std::unique_ptr<table>> tables_;
+			const std::unique_ptr<std::atomic<entry*>[]> pages_;
+			std::vector<std::unique_ptr<value_type[]>> blocks_;
+			value_type* cursor_;
+			size_type left_;
+			std::atomic<id_type> count_;
+			std::mutex mutex_;
+		};
+
+		// Copies str to the arena. Strings larger than a block get their own.
+		inline const typename intern_pool::value_type*
+			intern_pool::copy(const basic_string_view& str) {
+			auto const n = str.size();
+			if (n > left_) {
+				if (n > block_size / 4) {
+					blocks_.emplace_back(new value_type[n]);
+					memcpy(blocks_.back().get(), str.data(), n * sizeof(value_type));
+					return blocks_.back().get();
+				}
+				blocks_.emplace_back(new value_type[block_size]);
+				cursor_ = blocks_.back().get();
+				left_ = block_size;
+			}
+			auto const p = cursor_;
+			memcpy(p, str.data(), n * sizeof(value_type));
+			cursor_ += n;
+			left_ -= n;
+			return p;
+		}
+
+		inline typename intern_pool::id_type
+			intern_pool::find(const basic_string_view& str, uint64_t h) const {
+			auto const t = table_.load(std::memory_order_acquire);
+			for (auto i = (size_type)h & t->mask;; i = (i + 1) & t->mask) {
+				auto const v = t->slots[i].load(std::memory_order_acquire);
+				if (v == 0) {
+					return npos;
+				}
+				if ((v ^ h) >> 32 == 0) {
+					auto const id = (id_type)(v - 1);
+					auto const& e = at(id);
+					if (e.hash == h && e.size == str.size() && memcmp(e.data, str.data(), str.size() * sizeof(value_type)) == 0) {
+						return id;
+					}
+				}
+			}
+		}
+
+		inline void intern_pool::insert(table& t, id_type id, uint64_t h) {
+			auto i = (size_type)h & t.mask;
+			while (t.slots[i].load(std::memory_order_relaxed) != 0) {
+				i = (i + 1) & t.mask;
+			}
+			t.slots[i].store(slot(id, h), std::memory_order_release);
+		}
+
+		inline typename intern_pool::id_type
+			intern_pool::intern(const basic_string_view& str) {
+			auto const h = hash(str);
+			auto id = find(str, h);
+			if (id != npos) {
+				return id;
+			}
+			std::lock_guard<std::mutex> lock(mutex_);
+			id = find(str, h);
+			if (id != npos) {
+				return id;
+			}
+			id = count_.load(std::memory_order_relaxed);
+			if (id == npos || str.size() > UINT32_MAX) {
+				return npos;
+			}
+			auto& page = pages_[id >> page_bits];
+			if (page.load(std::memory_order_relaxed) == nullptr) {
+				page.store(new entry[size_type(1) << page_bits], std::memory_order_release);
+			}
+			page.load(std::memory_order_relaxed)[id & ((1 << page_bits) - 1)] = entry{ h, copy(str), (uint32_t)str.size() };
+			auto t = table_.load(std::memory_order_relaxed);
+			if ((id + size_type(1)) * 4 > (t->mask + 1) * 3) {
+				tables_.emplace_back(new table((t->mask + 1) * 2));
+				t = tables_.back().get();
+				for (id_type i = 0; i < id; ++i) {
+					insert(*t, i, at(i).hash);
+				}
+				table_.store(t, std::memory_order_release);
+			}
+			insert(*t, id, h);
+			count_.store(id + 1, std::memory_order_release);
+			return id;
+		}
+
+	} // namespace text
+
+} // namespace circus
@@ -0,0 +1,221 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// An index of the line starts of a text.
+//
+// Finding the n-th line of a text by scanning it for line breaks is O(n)
+// per access. The index holds the offset of the first unit of each line
+// in a flat array of 32-bit offsets, so start is O(1) and find, the line
+// of an offset, is a binary search. Lines end with LF, CR or CRLF; a
+// break at the end of the text starts an empty last line.
+//
+// Breaks are found with vectorized kernels (see detail/line_index-detail.h)
+// that run on char16_t buffers as well as bytes, so that a memory-mapped
+// 8-bit file can be indexed in bytes without decoding. Texts of more than
+// 2M units per thread are split across threads like batch hashes, each
+// range collecting its own starts, since a break only depends on its
+// unit and the next one.
+//
+// update takes the edited text and the replaced range, and rescans the
+// inserted units and the one before them only. Starts after the range
+// are shifted by the size difference lazily: starts from index from_ on
+// are pending_ units off, and only the ones between 2 successive edits
+// are adjusted, so typing at a place is O(1) rather than O(lines). Line
+// starts are only moved in the array when the number of lines changes.
+// Edits are in chars, so only an index of chars (see editable) can be
+// updated; a file indexed in bytes cannot.
+
+
+#pragma once
+
+#include <algorithm>
+#include <stdint.h>
+#include <thread>
+#include <vector>
+
+#include "detail/line_index-detail.h"
+
+namespace circus {
+
+	namespace text {
+
+		namespace detail {
+
+			static const size_t line_batch_units = 1 << 21;
+
+		} // namespace detail
+
+		class line_index {
+		public:
+
+			// Types
+			typedef char16_t value_type;
+			typedef size_t size_type;
+
+		public:
+			line_index() : starts_(1, 0), from_(1), pending_(0), size_(0), editable_(true) {
+			}
+
+			line_index(const line_index& line_index) = delete;
+
+			line_index& operator=(const line_index& line_index) = delete;
+
+			// Indexes the n units of p. Offsets are shifted left by shift, i.e.
+			// 1 to index a UTF-16 file in bytes.
+			template <typename T>
+			inline void assign(const T* p, size_type n, unsigned shift = 0);
+
+			size_type count() const {
+				return starts_.size();
+			}
+
+			// Returns true if offsets are the chars of a UTF-16 text, which
+			// update requires.
+			bool editable() const {
+				return editable_;
+			}
+
+			// Returns the line that contains offset.
+			size_type find(size_type offset) const {
+				return upper_bound((uint32_t)offset, 0) - 1;
+			}
+
+			// Returns the number of units of the indexed text.
+			size_type size() const {
+				return size_;
+			}
+
+			// Returns the offset of the first unit of line.
+			size_type start(size_type line) const {
+				return value(line);
+			}
+
+			// Updates the index after removed units at pos were replaced with
+			// inserted units, where p holds the n units of the edited text.
+			inline void update(const value_type* p, size_type n, size_type pos, size_type removed, size_type inserted);
+
+		private:
+			// Returns the first line at or after i whose start is greater than v.
+			size_type upper_bound(uint32_t v, size_type i) const {
+				auto j = starts_.size();
+				while (i < j) {
+					auto const mid = i + (j - i) / 2;
+					if (value(mid) <= v) {
+						i = mid + 1;
+					}
+					else {
+						j = mid;
+					}
+				}
+				return i;
+			}
+
+			uint32_t value(size_type i) const {
+				return i < from_ ? starts_[i] : starts_[i] + pending_;
+			}
+
+		private:
+			std::vector<uint32_t> starts_;
+			size_type from_;
+			uint32_t pending_;
+			size_type size_;
+			bool editable_;
+		};
+
+		template <typename T>
+		inline void line_index::assign(const T* p, size_type n, unsigned shift) {
+			starts_.assign(1, 0);
+			pending_ = 0;
+			size_ = n;
+			editable_ = sizeof(T) == sizeof(value_type) && shift == 0;
+			auto const workers = std::min<size_type>(std::thread::hardware_concurrency(), n / detail::line_batch_units);
+			if (workers < 2) {
+				detail::scan_breaks(p, 0, n, n, shift, starts_);
+				from_ = starts_.size();
+				return;
+			}
+			auto const step = (n + workers - 1) / workers;
+			std::vector<std::vector<uint32_t>> parts(workers);
+			std::vector<std::thread> threads;
+			threads.reserve(workers - 1);
+			for (size_type i = 1; i < workers; ++i) {
+				threads.emplace_back([=, &parts]() {
+					detail::scan_breaks(p, i * step, std::min(n, (i + 1) * step), n, shift, parts[i]);
+				});
+			}
+			detail::scan_breaks(p, 0, step, n, shift, starts_);
+			for (auto& t : threads) {
+				t.join();
+			}
+			auto size = starts_.size();
+			for (auto const& part : parts) {
+				size += part.size();
+			}
+			starts_.reserve(size);
+			for (auto const& part : parts) {
+				starts_.insert(starts_.end(), part.begin(), part.end());
+			}
+			from_ = starts_.size();
+		}
+
+		// A break at c starts line c + 1, and depends on c and c + 1. Breaks
+		// from pos - 1 to the end of the removed units are dropped, and the
+		// inserted units are scanned from pos - 1 in the edited text. The unit
+		// that followed the removed ones is unchanged and so is its next unit.
+		inline void line_index::update(const value_type* p, size_type n, size_type pos, size_type removed, size_type inserted) {
+			auto const from = pos == 0 ? 0 : pos - 1;
+			auto const first = upper_bound((uint32_t)from, 1);
+			auto const last = upper_bound((uint32_t)(pos + removed), first);
+			std::vector<uint32_t> breaks;
+			detail::scan_breaks(p, from, pos + inserted, n, 0, breaks);
+
+			// Settles the replaced starts, then splices the new ones.
+			for (; from_ < last; ++from_) {
+				starts_[from_] += pending_;
+			}
+			auto const j = first + breaks.size();
+			if (j < last) {
+				starts_.erase(starts_.begin() + j, starts_.begin() + last);
+			}
+			else {
+				starts_.insert(starts_.begin() + last, j - last, 0);
+			}
+			std::copy(breaks.begin(), breaks.end(), starts_.begin() + first);
+			from_ = from_ + j - last;
+
+			// Starts from j on are now delta units off. The ones before from_ were
+			// exact: either they take the delta, or the pending ones are settled
+			// so that all of them are pending, whichever is shorter.
+			auto const delta = (uint32_t)(inserted - removed);
+			if (from_ - j > starts_.size() - from_) {
+				for (auto k = from_; k < starts_.size(); ++k) {
+					starts_[k] += pending_;
+				}
+				pending_ = 0;
+				from_ = j;
+			}
+			else {
+				for (auto k = j; k < from_; ++k) {
+					starts_[k] += delta;
+				}
+			}
+			pending_ += delta;
+			size_ = size_ - removed + inserted;
+		}
+
+	} // namespace text
+
+} // namespace circus
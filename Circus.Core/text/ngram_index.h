@@ -0,0 +1,244 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// A trigram inverted index of strings keyed by id, for substring queries.
+//
+// Filtering a collection with Contains on each item is O(items.length)
+// per query. The index maps each trigram of the strings to the sorted
+// list of the strings that hold it, and a query of 3 chars or more only
+// verifies the strings in the intersection of the lists of its trigrams,
+// smallest list first (see detail/ngram_index-detail.h). Candidates are
+// verified with the vectorized basic_string_view::first, except for
+// queries of 3 chars whose list is the answer. Shorter queries verify
+// every string.
+//
+// Strings get a document number in insertion order and their chars are
+// kept in a single arena, folded when the index ignores case. Since
+// numbers only grow, a trigram list stays sorted by appending, and a
+// string that holds a trigram twice is found at the back of its list.
+// Removing a string marks its document dead; dead documents are skipped
+// by queries and dropped, with their chars, when they outnumber the live
+// ones. Ids are reported in insertion order.
+
+
+#pragma once
+
+#include <algorithm>
+#include <stdint.h>
+#include <unordered_map>
+#include <vector>
+
+#include "basic_string_view.h"
+#include "detail/fold-detail.h"
+#include "detail/ngram_index-detail.h"
+
+namespace circus {
+
+	namespace text {
+
+		class ngram_index {
+		public:
+
+			// Types
+			typedef char16_t value_type;
+			typedef size_t size_type;
+			typedef int64_t id_type;
+
+		public:
+			ngram_index(const ngram_index& ngram_index) = delete;
+
+			explicit ngram_index(bool fold) : dead_(0), fold_(fold) {
+			}
+
+			ngram_index& operator=(const ngram_index& ngram_index) = delete;
+
+			void clear() {
+				docs_.clear();
+				text_.clear();
+				ids_.clear();
+				lists_.clear();
+				dead_ = 0;
+			}
+
+			// Outputs the ids of up to cap strings that contain str. Returns the
+			// number of strings that contain it.
+			inline size_type find(const basic_string_view& str, id_type* ids, size_type cap) const;
+
+			// Inserts str with id, or replaces the string of id. Returns true if
+			// id was inserted.
+			inline bool insert(id_type id, const basic_string_view& str);
+
+			inline bool remove(id_type id);
+
+			size_type size() const {
+				return ids_.size();
+			}
+
+		private:
+			struct doc {
+				id_type id;
+				uint32_t offset;
+				uint32_t size;
+				bool alive;
+			};
+
+			inline void compact();
+
+			static uint64_t key(const value_type* p) {
+				return ((uint64_t)p[0] << 32) | ((uint64_t)p[1] << 16) | p[2];
+			}
+
+		private:
+			std::vector<doc> docs_;
+			std::vector<value_type> text_;
+			std::unordered_map<id_type, uint32_t> ids_;
+			std::unordered_map<uint64_t, std::vector<uint32_t>> lists_;
+			size_type dead_;
+			const bool fold_;
+		};
+
+		// Renumbers the live documents, which keeps the lists sorted.
+		inline void ngram_index::compact() {
+			std::vector<uint32_t> numbers(docs_.size());
+			std::vector<doc> docs;
+			std::vector<value_type> text;
+			docs.reserve(docs_.size() - dead_);
+			for (size_type i = 0; i < docs_.size(); ++i) {
+				auto d = docs_[i];
+				if (!d.alive) {
+					continue;
+				}
+				numbers[i] = (uint32_t)docs.size();
+				ids_[d.id] = (uint32_t)docs.size();
+				auto const offset = (uint32_t)text.size();
+				text.insert(text.end(), text_.begin() + d.offset, text_.begin() + d.offset + d.size);
+				d.offset = offset;
+				docs.push_back(d);
+			}
+			for (auto it = lists_.begin(); it != lists_.end();) {
+				auto& list = it->second;
+				size_type k = 0;
+				for (auto const i : list) {
+					if (docs_[i].alive) {
+						list[k++] = numbers[i];
+					}
+				}
+				if (k == 0) {
+					it = lists_.erase(it);
+					continue;
+				}
+				list.resize(k);
+				list.shrink_to_fit();
+				++it;
+			}
+			docs_.swap(docs);
+			text_.swap(text);
+			dead_ = 0;
+		}
+
+		inline typename ngram_index::size_type
+			ngram_index::find(const basic_string_view& str, id_type* ids, size_type cap) const {
+			auto const n = str.size();
+			std::vector<value_type> folded;
+			auto s = str.data();
+			if (fold_) {
+				folded.resize(n);
+				detail::fold_copy(str.data(), n, folded.data());
+				s = folded.data();
+			}
+			size_type count = 0;
+			auto const report = [&](const doc& d) {
+				if (count < cap) {
+					ids[count] = d.id;
+				}
+				++count;
+			};
+			if (n < 3) {
+				for (auto const& d : docs_) {
+					if (d.alive && (n == 0 || basic_string_view(text_.data() + d.offset, d.size).first(basic_string_view(s, n)) != basic_string_view::npos)) {
+						report(d);
+					}
+				}
+				return count;
+			}
+			std::vector<const std::vector<uint32_t>*> lists;
+			lists.reserve(n - 2);
+			for (size_type i = 0; i + 3 <= n; ++i) {
+				auto const it = lists_.find(key(s + i));
+				if (it == lists_.end()) {
+					return 0;
+				}
+				lists.push_back(&it->second);
+			}
+			std::sort(lists.begin(), lists.end(), [](const std::vector<uint32_t>* x, const std::vector<uint32_t>* y) {
+				return x->size() < y->size() || (x->size() == y->size() && x < y);
+			});
+			lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+			std::vector<uint32_t> candidates(*lists[0]);
+			auto size = candidates.size();
+			for (size_type i = 1; i < lists.size() && size != 0; ++i) {
+				size = detail::intersect(candidates.data(), size, lists[i]->data(), lists[i]->size(), candidates.data());
+			}
+			const basic_string_view query(s, n);
+			for (size_type i = 0; i < size; ++i) {
+				auto const& d = docs_[candidates[i]];
+				if (d.alive && (n == 3 || basic_string_view(text_.data() + d.offset, d.size).first(query) != basic_string_view::npos)) {
+					report(d);
+				}
+			}
+			return count;
+		}
+
+		inline bool ngram_index::insert(id_type id, const basic_string_view& str) {
+			auto const inserted = !remove(id);
+			auto const number = (uint32_t)docs_.size();
+			auto const offset = (uint32_t)text_.size();
+			auto const n = str.size();
+			text_.resize(text_.size() + n);
+			auto const p = text_.data() + offset;
+			if (fold_) {
+				detail::fold_copy(str.data(), n, p);
+			}
+			else {
+				std::copy(str.begin(), str.end(), p);
+			}
+			docs_.push_back(doc{ id, offset, (uint32_t)n, true });
+			ids_[id] = number;
+			for (size_type i = 0; i + 3 <= n; ++i) {
+				auto& list = lists_[key(p + i)];
+				if (list.empty() || list.back() != number) {
+					list.push_back(number);
+				}
+			}
+			return inserted;
+		}
+
+		inline bool ngram_index::remove(id_type id) {
+			auto const it = ids_.find(id);
+			if (it == ids_.end()) {
+				return false;
+			}
+			docs_[it->second].alive = false;
+			ids_.erase(it);
+			if (++dead_ > docs_.size() / 2) {
+				compact();
+			}
+			return true;
+		}
+
+	} // namespace text
+
+} // namespace circus
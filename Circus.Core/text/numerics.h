@@ -15,58 +15,230 @@
 //
 //
 // String to numeric types.
+//
+// Both is and parse read the string once. Digits are checked and
+// accumulated 8 at a time, and parse converts the digits it reads to an
+// int64_t and a double as it goes, so that callers do not parse the
+// string again after validating it.
+//
+// Doubles are rounded to nearest with the Eisel-Lemire algorithm, or
+// divided by an exact power of 10 when both fit in 53 bits. The few
+// numbers that are too close to a halfway point for it (more than 19
+// significant digits mostly) fall back to std::from_chars. See
+// detail/numerics-detail.h for details.
+//
+// classify runs the scan of parse over a column of cells in a single
+// call, split across threads for large columns like batch hashes, and
+// infers the type of the column from the flags of its cells.
+//
+// format writes the shortest digits that parse back to the same double,
+// from std::to_chars (Ryu in the MSVC STL), laid out as the round-trip
+// format of .NET. Integers are formatted 2 digits at a time. The batch
+// overload writes many values to a single buffer with offsets.
 
 
 #pragma once
 
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <string.h>
 #include <windef.h>
-#include "basic_string.h"
+
+#include "../hash/farmhash.h"
+#include "basic_string_view.h"
+#include "detail/numerics-detail.h"
 
 namespace circus {
 
 	namespace numerics {
 
+		// Flags output by parse.
+		enum flags {
+			is_signed = 1,
+			is_decimal = 2,
+			is_exponent = 4,
+
+			// The number is an integer that fits in int64_t, or in uint64_t
+			// when suffixed with U.
+			is_integer = 8,
+
+			// Type suffixes.
+			suffix_u = 16,
+			suffix_l = 32,
+			suffix_f = 64,
+			suffix_d = 128,
+			suffix_m = 256,
+
+			// Set by classify on cells that are numbers.
+			is_number = 512
+		};
+
 		// Determines if str is a number, s states if it's signed and d if
 		// it's a decimal. The function does not support typed values
-		// (e.g. 1U) nor E-notation (e.g. 1e-9).
-		BOOL is(const circus::text::basic_string& str, BOOL& s, BOOL& d) {
-			auto const len = str.length();
-
-			// Check if it's signed.
-			auto const minus = str[0] == '-';
+		// (e.g. 1U) nor E-notation (e.g. 1e-9), see parse.
+		BOOL is(const circus::text::basic_string_view& str, BOOL& s, BOOL& d) {
+			detail::number r;
+			if (!detail::scan(str.data(), str.size(), r, false)) {
+				return false;
+			}
+			if (r.flags & is_signed) {
+				s = true;
+			}
+			if (r.flags & is_decimal) {
+				d = true;
+			}
+			return true;
+		}
 
-			// Return false if str is '-', '-.' or '.'
-			if ((minus && (len == 1 || (len > 1 && str[1] == '.'))) || str[0] == '.') {
+		// Determines if the n chars of str are a number with an optional
+		// exponent (e.g. 1.5e-9) and type suffix (U, L, UL, F, D or M, e.g.
+		// 1UL), and converts it. Real outputs the nearest double, integer the
+		// value when it is an integer (see flags) and 0 otherwise.
+		BOOL parse(const char16_t* str, size_t n, int64_t& integer, double& real, int& flags) {
+			detail::number r;
+			if (!detail::scan(str, n, r, true)) {
 				return false;
 			}
+			auto const minus = (r.flags & is_signed) != 0;
+			integer = 0;
+			if (detail::integral(r)) {
+				integer = minus ? (int64_t)(0 - r.w) : (int64_t)r.w;
+				r.flags |= is_integer;
+			}
+			flags = r.flags;
+			if (r.w == 0) {
+				real = minus ? -0.0 : 0.0;
+				return true;
+			}
+			if (!r.inexact && r.w <= (1ull << 53) && r.q >= -22 && r.q <= 22) {
+				auto const w = (double)r.w;
+				real = r.q < 0 ? w / detail::pow10[-r.q] : w * detail::pow10[r.q];
+				real = minus ? -real : real;
+				return true;
+			}
+			bool ok;
+			auto bits = detail::lemire(r.w, r.q, ok);
+
+			// Dropped digits put the number between w and w + 1.
+			if (ok && r.inexact) {
+				bool ok1;
+				ok = r.w != UINT64_MAX && detail::lemire(r.w + 1, r.q, ok1) == bits && ok1;
+			}
+			if (ok) {
+				memcpy(&real, &bits, sizeof(real));
+			}
+			else {
+				std::string s;
+				s.reserve(r.last - r.first);
+				for (auto c = r.first; c < r.last; ++c) {
+					s.push_back((char)*c);
+				}
+				auto const result = std::from_chars(s.data(), s.data() + s.size(), real);
 
-			// Find any non-numeric char.
-			BOOL r = str.first_not_of("0123456789.", minus ? 1 : 0) == -1;
+				// Out of range leaves real as is: the number overflows when its
+				// exponent is positive (w is below 10^20), and underflows otherwise.
+				if (result.ec == std::errc::result_out_of_range) {
+					real = r.q > 0 ? HUGE_VAL : 0.0;
+				}
+				else if (result.ec != std::errc()) {
+					return false;
+				}
+			}
+			real = minus ? -real : real;
+			return true;
+		}
 
-			// Determine if it's decimal and ensure that it does not contain
-			// more than 1 separator.
-			if (r) {
-				auto const i = str.first('.');
-				if (i != -1) {
-					if (str.last('.') == i) {
-						d = true;
+		// Classifies count strings of blob at offsets (count + 1 of them) as
+		// parse does, extended or not. Outputs the flags of each cell to
+		// out, if not null: the parse flags plus is_number, or 0 if the cell
+		// is not a number. Returns the type of the column, 0 if a cell that
+		// is not empty is not a number, otherwise is_number plus is_integer
+		// if all the cells that are not empty are, plus all the other flags
+		// found. Empty cells are skipped.
+		int classify(const char16_t* blob, const int* offsets, size_t count, bool extended, int* out) {
+			std::atomic<int> any(0);
+			std::atomic<int> all(~0);
+			farmhash::detail::ForEachRange(offsets, count, [&](size_t first, size_t last) {
+				int a = 0, b = ~0;
+				for (auto i = first; i < last; ++i) {
+					auto const n = (size_t)(offsets[i + 1] - offsets[i]);
+					detail::number r;
+					int f = 0;
+					if (detail::scan(blob + offsets[i], n, r, extended)) {
+						f = r.flags | is_number | (detail::integral(r) ? is_integer : 0);
+					}
+					if (out != nullptr) {
+						out[i] = f;
 					}
-					else {
-						// More than 1 separator is found.
-						r = false;
+					if (n != 0) {
+						a |= f;
+						b &= f;
 					}
 				}
+				any.fetch_or(a);
+				all.fetch_and(b);
+			});
+			auto const a = any.load(), b = all.load();
+			if (a == 0 || (b & is_number) == 0) {
+				return 0;
 			}
+			return (a & ~is_integer) | (b & is_integer);
+		}
 
-			// Output signed flag.
-			if (r && minus) {
-				s = minus;
+		// Formats value to out, that holds detail::max_chars. Returns the number
+		// of chars written.
+		size_t format(int64_t value, char16_t* out) {
+			auto const v = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+			auto const n = detail::width(v) + (value < 0 ? 1 : 0);
+			detail::write_digits(v, out + n);
+			if (value < 0) {
+				*out = u'-';
 			}
-			return r;
+			return n;
 		}
-	
-	} // namespace numerics
 
-} // namespace circus
+		// Formats value to out, that holds detail::max_chars, with the shortest
+		// digits that round-trip. Returns the number of chars written.
+		size_t format(double value, char16_t* out) {
+			if (std::isnan(value) || std::isinf(value)) {
+				const char16_t* s = std::isnan(value) ? u"NaN" : value < 0 ? u"-Infinity" : u"Infinity";
+				auto const n = std::char_traits<char16_t>::length(s);
+				memcpy(out, s, n * sizeof(char16_t));
+				return n;
+			}
+			char buffer[32];
+			auto const r = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::scientific);
+			return detail::layout(buffer, r.ptr, out);
+		}
+
+		// Formats count values to out, that holds size chars, one after the
+		// other. Outputs the offsets of the values written plus the end of
+		// the last one. Returns the number of values written, less than count
+		// if out is full.
+		template <typename T>
+		size_t format(const T* values, size_t count, char16_t* out, size_t size, int* offsets) {
+			size_t n = 0, i = 0;
+			offsets[0] = 0;
+			for (; i < count; ++i) {
+				if (size - n >= detail::max_chars) {
+					n += format(values[i], out + n);
+				}
+				else {
+					char16_t buffer[detail::max_chars];
+					auto const k = format(values[i], buffer);
+					if (k > size - n) {
+						break;
+					}
+					memcpy(out + n, buffer, k * sizeof(char16_t));
+					n += k;
+				}
+				offsets[i + 1] = (int)n;
+			}
+			return i;
+		}
 
+	} // namespace numerics
 
+} // namespace circus
@@ -0,0 +1,128 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// A precompiled needle for repeated searches.
+//
+// Searching the same value in many strings (i.e. filtering a collection)
+// through the exports rebuilds the needle on every call. The searcher owns
+// a copy of the needle and of its lowercase-folded variant, built once,
+// so each search starts scanning right away.
+//
+// Both variants use the vectorized kernels of detail/search-detail.h. The
+// folded one folds haystack blocks in registers and compares them to the
+// folded needle, so no folded copy of the haystack is ever allocated.
+//
+// Boyer-Moore-Horspool shift tables were measured against the kernels
+// and lost for any needle length on text, since common chars keep shifts
+// small. They are not used.
+
+
+#pragma once
+
+#include <cassert>
+#include <stdlib.h>
+#include <string.h>
+
+#include "basic_string_view.h"
+
+namespace circus {
+
+	namespace text {
+
+		class searcher {
+		public:
+
+			// Types
+			typedef basic_string_view::value_type value_type;
+			typedef basic_string_view::size_type size_type;
+			static constexpr size_type npos = basic_string_view::npos;
+
+		public:
+			searcher() = delete;
+
+			searcher(const searcher& searcher) = delete;
+
+			searcher(const value_type* s, size_type n) noexcept : size_(n) {
+				init(s);
+			}
+
+			~searcher() noexcept {
+				free(data_);
+			}
+
+			searcher& operator=(const searcher& searcher) = delete;
+
+			const value_type* data() const {
+				return data_;
+			}
+
+			// Returns the first occurrence of the needle in str from pos.
+			size_type find(const basic_string_view& str, size_type pos = 0) const {
+				return search(detail::find_kernel, data(), str, pos);
+			}
+
+			// Returns the first occurrence of the needle in str from pos, ignoring
+			// case. See detail::fold for the chars that are folded.
+			size_type find_folded(const basic_string_view& str, size_type pos = 0) const {
+				return search(detail::find_folded_kernel, folded_, str, pos);
+			}
+
+			size_type size() const {
+				return size_;
+			}
+
+		private:
+			inline void init(const value_type* s);
+			inline size_type search(detail::search_fn f, const value_type* s, const basic_string_view& str, size_type pos) const;
+
+		private:
+			value_type* data_;
+			value_type* folded_;
+			const size_type size_;
+		};
+
+		inline void searcher::init(const value_type* s) {
+
+			// Both needles share a single buffer.
+			auto const n = size();
+			data_ = (value_type*)malloc(2 * n * sizeof(value_type));
+			assert(data_ != NULL);
+			folded_ = data_ + n;
+			for (size_type i = 0; i < n; ++i) {
+				data_[i] = s[i];
+				folded_[i] = detail::fold(s[i]);
+			}
+		}
+
+		inline typename searcher::size_type
+			searcher::search(detail::search_fn f,
+				const value_type* s,
+				const basic_string_view& str,
+				size_type pos) const {
+			auto const n = size();
+
+			// n + pos can overflow (eg pos == npos), guard against that by checking
+			// that n + pos does not wrap around.
+			if (n == 0 || n + pos > str.size() || n + pos < pos) {
+				return npos;
+			}
+			auto const r = f(str.data() + pos, str.size() - pos, s, n);
+			return r != npos ? pos + r : npos;
+		}
+
+	} // namespace text
+
+} // namespace circus
@@ -0,0 +1,294 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// An open addressing hash map of UTF-16 string keys and int64_t values.
+//
+// Map<string, U> walks chains of managed nodes and compares keys on the
+// managed side, after a P/Invoke to hash the key. This map does both in a
+// single native call. Values are meant to be indices or ids of managed
+// objects.
+//
+// The layout follows Swiss tables: a control byte per slot (see
+// detail/string_map-detail.h), probed 16 slots at a time, and a flat array
+// of slots. A slot holds the cached 64-bit hash, the value, and the offset
+// and size of the key in a single char16_t arena, that is 24 bytes plus 1
+// control byte per slot and 2 bytes per key char. Keys are only compared
+// when the 7 bits of the control byte and the full hash match.
+//
+// Groups are probed in triangular order, which visits each of them once
+// since their number is a power of 2. The load is kept below 7/8 so that
+// a probe always ends on a group with an empty slot. Removing a key marks
+// its slot deleted unless its group has an empty slot, in which case no
+// probe ever went past the group and the slot can be emptied.
+//
+// Keys hash with a random seed per map over the full UTF-16 chars. Growing
+// reuses cached hashes and compacts the arena when removed keys fill more
+// than half of it. The arena is indexed with 32-bit offsets.
+
+
+#pragma once
+
+#include <algorithm>
+#include <intrin.h>
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "../hash/farmhash.h"
+#include "basic_string_view.h"
+#include "detail/string_map-detail.h"
+
+namespace circus {
+
+	namespace text {
+
+		class string_map {
+		public:
+
+			// Types
+			typedef char16_t value_type;
+			typedef size_t size_type;
+			typedef int64_t mapped_type;
+			static constexpr size_type npos = size_type(-1);
+
+		public:
+			string_map(const string_map& string_map) = delete;
+
+			explicit string_map(size_type capacity = 0) : size_(0), deleted_(0), waste_(0), seed_(farmhash::detail::RandomSeed()) {
+				init(capacity);
+			}
+
+			string_map& operator=(const string_map& string_map) = delete;
+
+			void clear() {
+				std::fill(ctrl_.begin(), ctrl_.end(), detail::ctrl_empty);
+				keys_.clear();
+				size_ = deleted_ = waste_ = 0;
+			}
+
+			// Returns true and outputs the value of key if found.
+			bool find(const basic_string_view& key, mapped_type& value) const {
+				auto const i = find(key, hash(key));
+				if (i == npos) {
+					return false;
+				}
+				value = slots_[i].value;
+				return true;
+			}
+
+			// Inserts key with value. If key exists, updates its value when update
+			// is set. Returns true if the key was inserted or updated.
+			inline bool insert(const basic_string_view& key, mapped_type value, bool update);
+
+			// Returns the key of the full slot i.
+			basic_string_view key(size_type i) const {
+				return basic_string_view(keys_.data() + slots_[i].offset, slots_[i].size);
+			}
+
+			// Returns the first full slot at or after i, or npos.
+			inline size_type next(size_type i) const;
+
+			inline bool remove(const basic_string_view& key);
+
+			void reserve(size_type n) {
+				if (n > limit()) {
+					rehash(n);
+				}
+			}
+
+			size_type size() const {
+				return size_;
+			}
+
+			// Returns the value of the full slot i.
+			mapped_type value(size_type i) const {
+				return slots_[i].value;
+			}
+
+		private:
+			struct slot {
+				uint64_t hash;
+				mapped_type value;
+				uint32_t offset;
+				uint32_t size;
+			};
+
+			inline size_type find(const basic_string_view& key, uint64_t hash) const;
+			inline size_type find_free(uint64_t hash) const;
+
+			uint64_t hash(const basic_string_view& key) const {
+				return farmhash::hash64_local(key.data(), key.size(), seed_);
+			}
+
+			inline void init(size_type n);
+
+			size_type limit() const {
+				return slots_.size() - slots_.size() / 8;
+			}
+
+			inline void rehash(size_type n);
+
+			void set(size_type i, int8_t c) {
+				ctrl_[i] = c;
+			}
+
+		private:
+			std::vector<int8_t> ctrl_;
+			std::vector<slot> slots_;
+			std::vector<value_type> keys_;
+			size_type mask_;
+			size_type size_;
+			size_type deleted_;
+			size_type waste_;
+			const uint64_t seed_;
+		};
+
+		inline typename string_map::size_type
+			string_map::find(const basic_string_view& key, uint64_t hash) const {
+			auto const h2 = (int8_t)(hash & 0x7f);
+			auto g = (size_type)(hash >> 7) & mask_;
+			for (size_type i = 1;; ++i) {
+				auto const base = g * detail::group_width;
+				detail::ctrl_group const group(ctrl_.data() + base);
+				unsigned long bit;
+				for (auto m = group.match(h2); _BitScanForward(&bit, m); m &= m - 1) {
+					auto const& s = slots_[base + bit];
+					if (s.hash == hash && s.size == key.size() && memcmp(keys_.data() + s.offset, key.data(), key.size() * sizeof(value_type)) == 0) {
+						return base + bit;
+					}
+				}
+				if (group.match_empty() != 0) {
+					return npos;
+				}
+				g = (g + i) & mask_;
+			}
+		}
+
+		// Returns the first empty or deleted slot on the probe sequence of hash.
+		inline typename string_map::size_type
+			string_map::find_free(uint64_t hash) const {
+			auto g = (size_type)(hash >> 7) & mask_;
+			for (size_type i = 1;; ++i) {
+				unsigned long bit;
+				if (_BitScanForward(&bit, detail::ctrl_group(ctrl_.data() + g * detail::group_width).match_free())) {
+					return g * detail::group_width + bit;
+				}
+				g = (g + i) & mask_;
+			}
+		}
+
+		// Allocates the smallest power of 2 number of groups holding n keys.
+		inline void string_map::init(size_type n) {
+			size_type groups = 1;
+			while (groups * detail::group_width - groups * detail::group_width / 8 < n) {
+				groups <<= 1;
+			}
+			mask_ = groups - 1;
+			ctrl_.assign(groups * detail::group_width, detail::ctrl_empty);
+			slots_.resize(groups * detail::group_width);
+		}
+
+		inline bool string_map::insert(const basic_string_view& key, mapped_type value, bool update) {
+			auto const h = hash(key);
+			auto i = find(key, h);
+			if (i != npos) {
+				if (update) {
+					slots_[i].value = value;
+				}
+				return update;
+			}
+			if (size_ + deleted_ >= limit()) {
+				rehash(size_ + 1);
+			}
+			i = find_free(h);
+			if (ctrl_[i] == detail::ctrl_deleted) {
+				--deleted_;
+			}
+			set(i, (int8_t)(h & 0x7f));
+			slots_[i] = slot{ h, value, (uint32_t)keys_.size(), (uint32_t)key.size() };
+			keys_.insert(keys_.end(), key.begin(), key.end());
+			++size_;
+			return true;
+		}
+
+		inline typename string_map::size_type
+			string_map::next(size_type i) const {
+			for (; i < ctrl_.size(); ++i) {
+				if (ctrl_[i] >= 0) {
+					return i;
+				}
+			}
+			return npos;
+		}
+
+		// Rebuilds the map for at least n keys, doubling the slots when the map
+		// is actually full rather than filled with deleted slots.
+		inline void string_map::rehash(size_type n) {
+			if (n <= size_ * 2) {
+				n = size_ * 2;
+			}
+			std::vector<int8_t> ctrl;
+			std::vector<slot> slots;
+			ctrl.swap(ctrl_);
+			slots.swap(slots_);
+			init(n);
+			deleted_ = 0;
+			auto const compact = waste_ > keys_.size() / 2;
+			std::vector<value_type> keys;
+			if (compact) {
+				keys.reserve(keys_.size() - waste_);
+			}
+			for (size_type i = 0; i < ctrl.size(); ++i) {
+				if (ctrl[i] < 0) {
+					continue;
+				}
+				auto s = slots[i];
+				if (compact) {
+					auto const offset = (uint32_t)keys.size();
+					keys.insert(keys.end(), keys_.begin() + s.offset, keys_.begin() + s.offset + s.size);
+					s.offset = offset;
+				}
+				auto const j = find_free(s.hash);
+				set(j, ctrl[i]);
+				slots_[j] = s;
+			}
+			if (compact) {
+				keys_.swap(keys);
+				waste_ = 0;
+			}
+		}
+
+		inline bool string_map::remove(const basic_string_view& key) {
+			auto const i = find(key, hash(key));
+			if (i == npos) {
+				return false;
+			}
+			auto const base = i & ~(detail::group_width - 1);
+			if (detail::ctrl_group(ctrl_.data() + base).match_empty() != 0) {
+				set(i, detail::ctrl_empty);
+			}
+			else {
+				set(i, detail::ctrl_deleted);
+				++deleted_;
+			}
+			waste_ += slots_[i].size;
+			--size_;
+			return true;
+		}
+
+	} // namespace text
+
+} // namespace circus
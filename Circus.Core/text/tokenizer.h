@@ -0,0 +1,241 @@
+// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// A precompiled splitter of UTF-16 text into tokens.
+//
+// next outputs tokens as (start, length) pairs of offsets into the text
+// rather than strings, so that a split does not allocate. A token ends at
+// any char of the delimiter set; a delimiter at the end of the text does
+// not start an empty token, but 2 adjacent delimiters do. Leading and
+// trailing chars of the trim set are removed from tokens.
+//
+// A token starting with the quote char, after trimming, runs up to the
+// next unescaped quote, and its span excludes the quotes. Delimiters in
+// it are kept, and escapes are not removed from the span. When the
+// escape char is the quote char, a doubled quote is an escaped quote, as
+// in CSV; otherwise the escape char makes the next char literal, inside
+// or outside quotes. A zero quote or escape char disables it.
+//
+// Delimiters and quotes are found with char_set scans, 16 or 32 chars per
+// block. Without quote nor escape chars, every delimiter ends a token, so
+// the delimiters of a block are iterated from its bit mask rather than
+// scanned for one token at a time.
+//
+// The tokenizer holds no state between calls, so text can be split in
+// chunks: next only outputs tokens terminated by a delimiter unless last
+// is set, and outputs the offset at which the first incomplete token
+// starts. The caller feeds the text again from that offset followed by
+// the next chunk.
+
+
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+
+#include "basic_string_view.h"
+#include "char_set.h"
+
+namespace circus {
+
+	namespace text {
+
+		class tokenizer {
+		public:
+
+			// Types
+			typedef char16_t value_type;
+			typedef size_t size_type;
+			static constexpr size_type npos = size_type(-1);
+
+		public:
+			tokenizer() = delete;
+
+			tokenizer(const value_type* delimiters, size_type n, const value_type* trim, size_type n1, value_type quote, value_type escape) :
+				delimiters_(delimiters, n),
+				stops_(join(delimiters, n, escape != quote ? escape : 0).data(), n + (escape != 0 && escape != quote ? 1 : 0)),
+				quotes_(join(&quote, quote != 0 ? 1 : 0, escape).data(), (quote != 0 ? 1 : 0) + (escape != 0 && escape != quote ? 1 : 0)),
+				trim_(trim, n1),
+				quote_(quote),
+				escape_(escape),
+				plain_(quote == 0 && escape == 0 && trim_.first_of(delimiters, n) == npos) {
+			}
+
+			// Outputs up to cap tokens of str to spans, and the offset at which
+			// the next call must resume to consumed. Returns the number of
+			// tokens.
+			inline size_type next(const basic_string_view& str, bool last, int* spans, size_type cap, size_type& consumed) const;
+
+		private:
+			inline size_type close(const value_type* p, size_type i, size_type n, bool last) const;
+			inline void emit(const value_type* p, size_type first, size_type last, int* spans, size_type i) const;
+			inline size_type end(const value_type* p, size_type i, size_type n) const;
+			inline size_type split(const value_type* p, size_type n, bool last, int* spans, size_type cap, size_type& consumed) const;
+
+			static std::vector<value_type> join(const value_type* s, size_type n, value_type c) {
+				std::vector<value_type> r(s, s + n);
+				if (c != 0) {
+					r.push_back(c);
+				}
+				return r;
+			}
+
+		private:
+			const char_set delimiters_;
+			const char_set stops_;
+			const char_set quotes_;
+			const char_set trim_;
+			const value_type quote_;
+			const value_type escape_;
+			const bool plain_;
+		};
+
+		// Returns the closing quote of a quoted token whose content starts at
+		// i, or npos if it is not in p. A quote at the end of a chunk may be
+		// the first of a doubled quote, so it only closes the token when last
+		// is set.
+		inline typename tokenizer::size_type
+			tokenizer::close(const value_type* p, size_type i, size_type n, bool last) const {
+			for (;;) {
+				auto const j = quotes_.first_of(p, n, i);
+				if (j == npos) {
+					return npos;
+				}
+				if (p[j] != quote_) {
+					i = j + 2;
+					continue;
+				}
+				if (escape_ == quote_) {
+					if (j + 1 == n && !last) {
+						return npos;
+					}
+					if (j + 1 < n && p[j + 1] == quote_) {
+						i = j + 2;
+						continue;
+					}
+				}
+				return j;
+			}
+		}
+
+		// Outputs the span of the token in [first, last) without its trimmed
+		// chars as the i-th pair of spans.
+		inline void tokenizer::emit(const value_type* p, size_type first, size_type last, int* spans, size_type i) const {
+			while (first < last && trim_.contains(p[first])) {
+				++first;
+			}
+			while (last > first && trim_.contains(p[last - 1])) {
+				--last;
+			}
+			spans[2 * i] = (int)first;
+			spans[2 * i + 1] = (int)(last - first);
+		}
+
+		// Returns the first unescaped delimiter at or after i, or npos.
+		inline typename tokenizer::size_type
+			tokenizer::end(const value_type* p, size_type i, size_type n) const {
+			for (;;) {
+				auto const j = stops_.first_of(p, n, i);
+				if (j == npos || delimiters_.contains(p[j])) {
+					return j;
+				}
+				i = j + 2;
+			}
+		}
+
+		inline typename tokenizer::size_type
+			tokenizer::next(const basic_string_view& str, bool last, int* spans, size_type cap, size_type& consumed) const {
+			auto const p = str.data();
+			auto const n = str.size();
+			if (plain_) {
+				return split(p, n, last, spans, cap, consumed);
+			}
+			size_type pos = 0;
+			size_type count = 0;
+			while (count < cap && pos < n) {
+				auto i = pos;
+				while (i < n && trim_.contains(p[i])) {
+					++i;
+				}
+				size_type first, length, stop;
+				if (i < n && quote_ != 0 && p[i] == quote_) {
+					auto const j = close(p, i + 1, n, last);
+					first = i + 1;
+					if (j == npos) {
+						length = n - first;
+						stop = npos;
+					}
+					else {
+						length = j - first;
+						stop = end(p, j + 1, n);
+					}
+				}
+				else {
+					stop = end(p, i, n);
+					auto k = stop == npos ? n : stop;
+					while (k > i && trim_.contains(p[k - 1])) {
+						--k;
+					}
+					first = i;
+					length = k - i;
+				}
+				if (stop == npos) {
+					// The token is incomplete, or only trimmed chars remain.
+					if (last) {
+						if (i < n) {
+							spans[2 * count] = (int)first;
+							spans[2 * count + 1] = (int)length;
+							++count;
+						}
+						pos = n;
+					}
+					break;
+				}
+				spans[2 * count] = (int)first;
+				spans[2 * count + 1] = (int)length;
+				++count;
+				pos = stop + 1;
+			}
+			consumed = pos;
+			return count;
+		}
+
+		// Splits text without quotes nor escapes, where every delimiter ends a
+		// token, iterating over the delimiter bits of each block.
+		inline typename tokenizer::size_type
+			tokenizer::split(const value_type* p, size_type n, bool last, int* spans, size_type cap, size_type& consumed) const {
+			size_type pos = 0;
+			size_type count = 0;
+			if (cap != 0) {
+				delimiters_.for_each_of(p, n, 0, [&](size_type j) {
+					emit(p, pos, j, spans, count);
+					pos = j + 1;
+					return ++count < cap;
+				});
+			}
+			if (last && count < cap && pos < n) {
+				if (trim_.first_not_of(p, n, pos) != npos) {
+					emit(p, pos, n, spans, count++);
+				}
+				pos = n;
+			}
+			consumed = pos;
+			return count;
+		}
+
+	} // namespace text
+
+} // namespace circus
@@ -180,7 +180,7 @@ namespace Circus.Collections.Concurrency {
             return false;
         }
         private Bucket<ulong> GetBucketInfo(T key) {
-            ulong num = this.flag ? StringInfo.GetHash(key.ToString()) : (ulong)(key.GetHashCode() & int.MaxValue);
+            ulong num = this.flag ? StringInfo.GetLocalHash(key.ToString()) : (ulong)(this.comparer.GetHashCode(key) & int.MaxValue);
             return new Bucket<ulong>(num, (int)(num % (ulong)list.Entries.Length));
         }
         public IEnumerator<T> GetEnumerator() {
@@ -137,7 +137,10 @@ namespace Circus.Collections {
             return this.Find(key, out _, out _);
         }
         private bool Find(T key, out Node node, out Bucket<ulong> bucket) {
-            bucket = this.GetBucketInfo(key);
+            return this.Find(key, this.GetBucketInfo(key), out node, out bucket);
+        }
+        private bool Find(T key, Bucket<ulong> info, out Node node, out Bucket<ulong> bucket) {
+            bucket = info;
             for (Node n = this.array[bucket.Index]; n != null; n = n.Next) {
                 if (comparer.Equals(key, n.Key)) {
                     node = n;
@@ -153,7 +156,9 @@ namespace Circus.Collections {
             return f;
         }
         private Bucket<ulong> GetBucketInfo(T key) {
-            ulong num = this.flag ? StringInfo.GetHash(key.ToString()) : (ulong)(key.GetHashCode() & int.MaxValue);
+            return this.GetBucketInfo(this.flag ? StringInfo.GetLocalHash(key.ToString()) : (ulong)(this.comparer.GetHashCode(key) & int.MaxValue));
+        }
+        private Bucket<ulong> GetBucketInfo(ulong num) {
             return new Bucket<ulong>(num, (int)(num % (ulong)this.array.Length));
         }
         public IEnumerator<KeyValuePair<T, U>> GetEnumerator() {
@@ -185,6 +190,35 @@ namespace Circus.Collections {
         }
         private void Initialize(IEnumerable<KeyValuePair<T, U>> array) {
             this.array = new Node[this.Capacity];
+            if (this.flag) {
+
+                // String keys are hashed in a single native call, and reduced
+                // to buckets in another one once the array is sized to hold
+                // all of them.
+                KeyValuePair<T, U>[] pairs = new List<KeyValuePair<T, U>>(array).ToArray();
+                string[] keys = new string[pairs.Length];
+                for (int i = 0; i < pairs.Length; i++) {
+                    keys[i] = pairs[i].Key.ToString();
+                }
+                ulong[] hashes = StringInfo.GetLocalHash(keys);
+                int slot = Numeric.LadderSlot(Math.Max(this.Capacity, pairs.Length + 1));
+                if (slot > -1 && Numeric.LadderPrime(slot) <= int.MaxValue) {
+                    this.array = new Node[Numeric.LadderPrime(slot)];
+                    int[] indices = Numeric.BucketIndex(hashes, slot);
+                    for (int i = 0; i < pairs.Length; i++) {
+                        if (!this.Find(pairs[i].Key, new Bucket<ulong>(hashes[i], indices[i]), out _, out Bucket<ulong> bucket)) {
+                            this.Add(pairs[i].Key, pairs[i].Value, bucket);
+                        }
+                    }
+                    return;
+                }
+                for (int i = 0; i < pairs.Length; i++) {
+                    if (!this.Find(pairs[i].Key, this.GetBucketInfo(hashes[i]), out _, out Bucket<ulong> bucket)) {
+                        this.Add(pairs[i].Key, pairs[i].Value, bucket);
+                    }
+                }
+                return;
+            }
             foreach (KeyValuePair<T, U> pair in array) {
                 this.Add(pair.Key, pair.Value);
             }
@@ -194,7 +228,7 @@ namespace Circus.Collections {
                 this.comparer = (IEqualityComparer<T>)(IEqualityComparer<string>)new Text.StringComparer();
                 flag = true;
             }
-            this.Capacity = capacity != 5 ? Numeric.NextPrime(capacity) : capacity;
+            this.Capacity = capacity != 5 ? Numeric.NextCapacity(capacity) : capacity;
         }
         public IEnumerable<T> Keys() {
             for (int i = 0; i < this.array.Length; i++) {
@@ -221,7 +255,7 @@ namespace Circus.Collections {
             this.ResizeCore(size);
         }
         private void ResizeCore(int size) {
-            size = Numeric.NextPrime(size);
+            size = Numeric.NextCapacity(size);
             Node[] array = new Node[size];
             for (int i = 0; i < this.array.Length; i++) {
                 Node current = this.array[i];
@@ -19,9 +19,9 @@
 // The purpose was to have an improved version of HashSet<T> and especially
 // when dealing with strings.
 //
-// It uses Google's Farmhash for string hashing which provides a better 
-// distribution and therefore avoids a cost effective rehashing since the number 
-// of collisions is kept low.
+// It hashes strings with XXH3 and the random seed of the process (see
+// StringInfo.GetLocalHash), which provides a better distribution and therefore
+// avoids a cost effective rehashing since the number of collisions is kept low.
 //
 // Collisions are handled with a linked list instead of a bucket list. This 
 // avoids filling the bucket list with a loop on each resize.
@@ -33,8 +33,9 @@
 //
 // Like other containers, Set allows to define an offset for a better control on 
 // memory allocation, but the number of reserved buckets is increased to the next 
-// upper prime to maintain collisions frequency at lowest. This is why the actual 
-// size may be greater than the previous size + offset.
+// prime of a fixed ladder (about 1.5x apart, see Circus.Core/hash/ladder.h) to 
+// maintain collisions frequency at lowest. This is why the actual size may be 
+// greater than the previous size + offset.
 
 
 using System;
@@ -144,7 +145,7 @@ namespace Circus.Collections {
             return false;
         }
         private Bucket<ulong> GetBucketInfo(T key) {
-            ulong num = this.flag ? StringInfo.GetHash(key.ToString()) : (ulong)(key.GetHashCode() & int.MaxValue);
+            ulong num = this.flag ? StringInfo.GetLocalHash(key.ToString()) : (ulong)(this.comparer.GetHashCode(key) & int.MaxValue);
             return new Bucket<ulong>(num, (int)(num % (ulong)this.array.Length));
         }
         public IEnumerator<T> GetEnumerator() {
@@ -182,7 +183,7 @@ namespace Circus.Collections {
                 flag = true;
             }
             if (capacity != 5) {
-                capacity = Numeric.NextPrime(capacity);
+                capacity = Numeric.NextCapacity(capacity);
             }
             this.Capacity = capacity;
         }
@@ -204,7 +205,7 @@ namespace Circus.Collections {
             this.ResizeCore(size);
         }
         private void ResizeCore(int size) {
-            size = Numeric.NextPrime(size);
+            size = Numeric.NextCapacity(size);
             Node[] array = new Node[size];
             for (int i = 0; i < this.array.Length; i++) {
                 Node current = this.array[i];
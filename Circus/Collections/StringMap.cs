@@ -0,0 +1,170 @@
+﻿// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// An unordered associative container of string keys and long values held
+// in native memory.
+//
+// Unlike Map<string, U>, keys are hashed and compared in a single native
+// call, and entries are not managed objects. Values are meant to be
+// indices or ids of managed objects. See Circus.Core/text/string_map.h for
+// details.
+//
+// The object holds native memory and must be disposed. Enumerating while
+// the container is modified is not supported.
+
+
+#pragma warning disable IDE0002
+
+using System;
+using System.Collections;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+using System.Security;
+namespace Circus.Collections {
+    /// <summary>Provides an unordered associative container of string keys and long values held in native memory.</summary>
+    public sealed class StringMap : IDisposable, IEnumerable<KeyValuePair<string, long>> {
+        private IntPtr handle;
+        public long this[string key] { get => this.Get(key, out long value) ? value : default; set => this.Add(key, value, true); }
+        public int Count => StringMap.StringMapCount(this.handle);
+        public bool Empty => this.Count == 0;
+        /// <summary>Constructs an empty container.</summary>
+        public StringMap() : this(0) {
+        }
+        /// <summary>Constructs a container that holds the specified number of elements without reallocating.</summary>
+        [SecuritySafeCritical]
+        public StringMap(int capacity) {
+            this.handle = StringMap.CreateStringMap(capacity);
+        }
+        ~StringMap() {
+            this.Dispose(false);
+        }
+        /// <summary>Inserts the specified element to the container. Returns false if the key already exists.</summary>
+        public bool Add(string key, long value) {
+            return this.Add(key, value, false);
+        }
+        [SecuritySafeCritical]
+        private unsafe bool Add(string key, long value, bool update) {
+            fixed (char* ptr = key) {
+                return StringMap.StringMapAdd(this.handle, ptr, key.Length, value, update);
+            }
+        }
+        /// <summary>Inserts the specified element to the container. If the key already exists, updates its value.</summary>
+        public void AddOrUpdate(string key, long value) {
+            this.Add(key, value, true);
+        }
+        [SecuritySafeCritical]
+        public void Clear() {
+            StringMap.StringMapClear(this.handle);
+        }
+        public bool Contains(string key) {
+            return this.Get(key, out _);
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr CreateStringMap(int capacity);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void DestroyStringMap(IntPtr map);
+        public void Dispose() {
+            this.Dispose(true);
+        }
+        [SecuritySafeCritical]
+        private void Dispose(bool disposing) {
+            if (this.handle != IntPtr.Zero) {
+                StringMap.DestroyStringMap(this.handle);
+                this.handle = IntPtr.Zero;
+            }
+            if (disposing) {
+                GC.SuppressFinalize(this);
+            }
+        }
+        /// <summary>Accesses the element with the specified key. Return true if the key exists.</summary>
+        [SecuritySafeCritical]
+        public unsafe bool Get(string key, out long value) {
+            fixed (char* ptr = key) {
+                return StringMap.StringMapGet(this.handle, ptr, key.Length, out value);
+            }
+        }
+        public IEnumerator<KeyValuePair<string, long>> GetEnumerator() {
+            for (int i = this.Next(0, out string key, out long value); i > -1; i = this.Next(i + 1, out key, out value)) {
+                yield return new KeyValuePair<string, long>(key, value);
+            }
+        }
+        IEnumerator IEnumerable.GetEnumerator() {
+            return this.GetEnumerator();
+        }
+        /// <summary>Returns iterator of keys.</summary>
+        public IEnumerable<string> Keys() {
+            foreach (KeyValuePair<string, long> pair in this) {
+                yield return pair.Key;
+            }
+        }
+        [SecuritySafeCritical]
+        private unsafe int Next(int i, out string key, out long value) {
+            i = StringMap.StringMapNext(this.handle, i, out char* ptr, out int n, out value);
+            key = i > -1 ? new string(ptr, 0, n) : null;
+            return i;
+        }
+        /// <summary>Removes the specified element. Returns true if removal succeded.</summary>
+        [SecuritySafeCritical]
+        public unsafe bool Remove(string key) {
+            fixed (char* ptr = key) {
+                return StringMap.StringMapRemove(this.handle, ptr, key.Length);
+            }
+        }
+        /// <summary>Reallocates to hold the specified number of elements.</summary>
+        [SecuritySafeCritical]
+        public void Reserve(int size) {
+            StringMap.StringMapReserve(this.handle, size);
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe bool StringMapAdd(IntPtr map, char* str, int n, long value, bool update);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void StringMapClear(IntPtr map);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int StringMapCount(IntPtr map);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe bool StringMapGet(IntPtr map, char* str, int n, out long value);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int StringMapNext(IntPtr map, int i, out char* str, out int n, out long value);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe bool StringMapRemove(IntPtr map, char* str, int n);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void StringMapReserve(IntPtr map, int n);
+        /// <summary>Returns iterator of values.</summary>
+        public IEnumerable<long> Values() {
+            foreach (KeyValuePair<string, long> pair in this) {
+                yield return pair.Value;
+            }
+        }
+    }
+}
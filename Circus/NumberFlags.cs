@@ -0,0 +1,39 @@
+﻿// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Flags output by Numeric.Parse and Numeric.Classify. See
+// Circus.Core/text/numerics.h for details.
+
+
+namespace Circus {
+    /// <summary>Specifies the form of a number parsed by Numeric.Parse or classified by Numeric.Classify.</summary>
+    [System.Flags]
+    public enum NumberFlags {
+        None = 0,
+        Signed = 1,
+        Decimal = 2,
+        Exponent = 4,
+        /// <summary>The number is an integer that fits in a long, or in an ulong when suffixed with U.</summary>
+        Integer = 8,
+        UnsignedSuffix = 16,
+        LongSuffix = 32,
+        FloatSuffix = 64,
+        DoubleSuffix = 128,
+        DecimalSuffix = 256,
+        /// <summary>Set by Numeric.Classify on values that are numbers.</summary>
+        Number = 512
+    }
+}
@@ -36,6 +36,7 @@ using System.Runtime.InteropServices;
 using System.Security;
 using Circus.Collections;
 using Circus.Runtime;
+using Circus.Text;
 namespace Circus {
     /// <summary>Provides a set of methods for numeric values and numeric types.</summary>
     public sealed class Numeric {
@@ -46,6 +47,28 @@ namespace Circus {
         }
         private Numeric() {
         }
+        /// <summary>Returns the bucket of the provided hash in a table sized to the prime of the ladder slot, same as hash % LadderPrime(slot). Returns -1 if slot is out of the ladder or its prime is greater than int.MaxValue.</summary>
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int BucketIndex(ulong hash, int slot);
+        /// <summary>Returns the buckets of the provided hashes in a single call. See BucketIndex(ulong, int).</summary>
+        [SecuritySafeCritical]
+        public static unsafe int[] BucketIndex(ulong[] hashes, int slot) {
+            int[] indices = new int[hashes.Length];
+            fixed (ulong* ptr = hashes) {
+                fixed (int* ptr2 = indices) {
+                    if (!Numeric.BucketIndexBatch(ptr, hashes.Length, slot, ptr2)) {
+                        throw new ArgumentOutOfRangeException(nameof(slot));
+                    }
+                }
+            }
+            return indices;
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe bool BucketIndexBatch(ulong* hashes, int count, int slot, int* indices);
         /// <summary>Converts the provided object to the T numeric type. Value and T must be of the same type.</summary>
         public static bool Cast<T>(object value, out T result) {
             return (Allocator.Assign(Numeric.Cast(value, typeof(T), out dynamic r), out bool num) & Allocator.Assign(num ? (T)r : default, out result)) && num;
@@ -54,6 +77,90 @@ namespace Circus {
         public static bool Cast(object value, Type type, out dynamic result) {
             return Allocator.Assign(value.GetType() == type ? Convert.ChangeType(value, type) : null, out result) && Circus.Assert.NotNull(result);
         }
+        /// <summary>Classifies the provided strings in a single call. Outputs the flags of each value, None if it is not a number. Returns the type of the column: None if a value that is not empty is not a number, otherwise Number, plus Integer if all the values that are not empty are, plus all the other flags found. Null and empty values are skipped.</summary>
+        [SecuritySafeCritical]
+        public static unsafe NumberFlags Classify(string[] values, bool extended, out NumberFlags[] flags) {
+            char[] blob = StringInfo.Join(values, out int[] offsets);
+            int[] num = new int[values.Length];
+            int r;
+            fixed (char* ptr = blob) {
+                fixed (int* ptr2 = offsets) {
+                    fixed (int* ptr3 = num) {
+                        r = Numeric.ClassifyColumn(ptr, ptr2, values.Length, extended, ptr3);
+                    }
+                }
+            }
+            flags = new NumberFlags[values.Length];
+            for (int i = 0; i < values.Length; i++) {
+                flags[i] = (NumberFlags)num[i];
+            }
+            return (NumberFlags)r;
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int ClassifyColumn(char* str, int* offsets, int count, bool extended, int* flags);
+        /// <summary>Returns the number of primes between the provided bounds, inclusive. Ranges are sieved up to 2^56, values past it are tested one by one.</summary>
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern long CountPrimes(long lo, long hi);
+        /// <summary>Returns the shortest string that parses back to the provided value. Uses the round-trip layout of .NET (E-notation past 1E+15 and below 1E-04).</summary>
+        [SecuritySafeCritical]
+        public static unsafe string Format(double value) {
+            char* ptr = stackalloc char[24];
+            return new string(ptr, 0, Numeric.FormatDouble(value, ptr, 24));
+        }
+        /// <summary>Returns the string of the provided value.</summary>
+        [SecuritySafeCritical]
+        public static unsafe string Format(long value) {
+            char* ptr = stackalloc char[24];
+            return new string(ptr, 0, Numeric.FormatInt64(value, ptr, 24));
+        }
+        /// <summary>Formats the provided values one after the other into buffer in a single call, as Format(double). Outputs the offset of each value plus the end of the last one to offsets, that holds values.Length + 1 entries. Returns the number of values written, less than values.Length if buffer is full. 24 chars per value always fit.</summary>
+        [SecuritySafeCritical]
+        public static unsafe int Format(double[] values, char[] buffer, int[] offsets) {
+            if (offsets.Length <= values.Length) {
+                throw new ArgumentException("Offsets must hold values.Length + 1 entries.", nameof(offsets));
+            }
+            fixed (double* ptr = values) {
+                fixed (char* ptr2 = buffer) {
+                    fixed (int* ptr3 = offsets) {
+                        return Numeric.FormatDoubleBatch(ptr, values.Length, ptr2, buffer.Length, ptr3);
+                    }
+                }
+            }
+        }
+        /// <summary>Formats the provided values one after the other into buffer in a single call, as Format(long). Outputs the offset of each value plus the end of the last one to offsets, that holds values.Length + 1 entries. Returns the number of values written, less than values.Length if buffer is full. 24 chars per value always fit.</summary>
+        [SecuritySafeCritical]
+        public static unsafe int Format(long[] values, char[] buffer, int[] offsets) {
+            if (offsets.Length <= values.Length) {
+                throw new ArgumentException("Offsets must hold values.Length + 1 entries.", nameof(offsets));
+            }
+            fixed (long* ptr = values) {
+                fixed (char* ptr2 = buffer) {
+                    fixed (int* ptr3 = offsets) {
+                        return Numeric.FormatInt64Batch(ptr, values.Length, ptr2, buffer.Length, ptr3);
+                    }
+                }
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int FormatDouble(double value, char* str, int n);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int FormatDoubleBatch(double* values, int count, char* str, int n, int* offsets);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int FormatInt64(long value, char* str, int n);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int FormatInt64Batch(long* values, int count, char* str, int n, int* offsets);
         /// <summary>Returns true if the provided type is of a numeric type.</summary>
         public static bool Is(Type type) {
             return Allocator.Assign(Nullable.GetUnderlyingType(type), out Type t) && (Numeric.Types.Contains(type) || (Assert.NotNull(t) && Numeric.Is(t)));
@@ -78,19 +185,93 @@ namespace Circus {
         [SuppressUnmanagedCodeSecurity]
         [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
         public static extern bool IsPrime(int value);
+        /// <summary>Determines if the provided value is a prime.</summary>
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern bool IsPrime64(long value);
         [SecurityCritical]
         [SuppressUnmanagedCodeSecurity]
         [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
         private static extern unsafe bool IsNumeric(char* value, int size, out bool signed, out bool _decimal);
+        /// <summary>Returns the prime of the provided slot of the capacity ladder, or 0 if slot is out of the ladder.</summary>
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern long LadderPrime(int slot);
+        /// <summary>Returns the first slot of the capacity ladder whose prime is equal or greater than the provided size, or -1 if size is past the ladder.</summary>
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int LadderSlot(long size);
+        /// <summary>Returns the prime capacity of a hash table holding the provided size. Uses the ladder when size is within it, otherwise the next prime.</summary>
+        internal static int NextCapacity(int size) {
+            long num = Numeric.LadderPrime(Numeric.LadderSlot(size));
+            return num > 0 && num <= int.MaxValue ? (int)num : Numeric.NextPrime(size);
+        }
         /// <summary>Returns the next prime equal or greater than the provided value.</summary>
         [SecurityCritical]
         [SuppressUnmanagedCodeSecurity]
         [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
         public static extern int NextPrime(int value);
+        /// <summary>Returns the next prime equal or greater than the provided value, or 0 if there is none below 2^63.</summary>
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern long NextPrime64(long value);
+        /// <summary>Parses the provided string in a single pass. Supports E-notation and type suffixes (U, L, UL, F, D and M). Outputs the nearest double, the integer value when flags has Integer, and the form of the number.</summary>
+        [SecuritySafeCritical]
+        public static unsafe bool Parse(string value, out long integer, out double real, out NumberFlags flags) {
+            fixed (char* ptr = value) {
+                bool r = Numeric.ParseNumber(ptr, value.Length, out integer, out real, out int num);
+                flags = r ? (NumberFlags)num : NumberFlags.None;
+                return r;
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe bool ParseNumber(char* value, int size, out long integer, out double real, out int flags);
+        /// <summary>Returns the upper bound of the prime cache.</summary>
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern int PrimeBound();
         /// <summary>Returns the previous prime equal or smaller than the provided value.</summary>
         [SecurityCritical]
         [SuppressUnmanagedCodeSecurity]
         [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
         public static extern int PreviousPrime(int value);
+        /// <summary>Returns the previous prime equal or smaller than the provided value.</summary>
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern long PreviousPrime64(long value);
+        /// <summary>Returns the primes between the provided bounds, inclusive, in ascending order. Ranges are sieved up to 2^56, values past it are tested one by one.</summary>
+        public static long[] PrimesInRange(long lo, long hi) {
+            long[] array = new long[Numeric.CountPrimes(lo, hi)];
+            Numeric.PrimesInRange(lo, hi, array);
+            return array;
+        }
+        /// <summary>Copies the primes between the provided bounds, inclusive, in ascending order to buffer up to its length. Returns the number of primes between the bounds. Ranges are sieved up to 2^56, values past it are tested one by one.</summary>
+        [SecuritySafeCritical]
+        public static unsafe long PrimesInRange(long lo, long hi, long[] buffer) {
+            fixed (long* ptr = buffer) {
+                long num = Numeric.PrimesInRange(lo, hi, ptr, buffer.Length);
+                if (num < 0) {
+                    throw new OutOfMemoryException();
+                }
+                return num;
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe long PrimesInRange(long lo, long hi, long* primes, long capacity);
+        /// <summary>Rebuilds the prime cache up to the provided value. Returns false if it could not be allocated.</summary>
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        public static extern bool SetPrimeBound(int value);
     }
 }
@@ -0,0 +1,74 @@
+﻿// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Searches files for a string without loading them in managed memory.
+//
+// The file is memory-mapped and scanned in parallel chunks natively, and
+// the occurrences are reported as (line, byte offset) pairs in file order.
+// Files with a UTF-16LE byte order mark are searched as UTF-16, others as
+// UTF-8. See Circus.Core/text/file_search.h for details.
+
+
+#pragma warning disable IDE0002
+
+using System;
+using System.Runtime.ExceptionServices;
+using System.Runtime.InteropServices;
+using System.Security;
+using System.Threading;
+namespace Circus.Text {
+    /// <summary>Provides a search of files that are not loaded in memory.</summary>
+    public static class FileSearch {
+        [UnmanagedFunctionPointer(CallingConvention.Cdecl)]
+        private unsafe delegate bool Callback(long* records, int count, long position, IntPtr state);
+        /// <summary>Finds all occurrences of value in the file at the specified path, and calls match with the 0-based line and the byte offset of each of them in file order. Returns the number of occurrences, or -1 if the file cannot be read.</summary>
+        public static long Find(string path, string value, Action<long, long> match) {
+            return FileSearch.Find(path, value, match, CancellationToken.None);
+        }
+        /// <summary>Finds all occurrences of value in the file at the specified path, and calls match with the 0-based line and the byte offset of each of them in file order. The search stops when the token is cancelled. Returns the number of occurrences reported, or -1 if the file cannot be read.</summary>
+        [SecuritySafeCritical]
+        public static unsafe long Find(string path, string value, Action<long, long> match, CancellationToken cancellationToken) {
+            Exception exception = null;
+            Callback callback = (records, count, position, state) => {
+                try {
+                    for (int i = 0; i < count; i++) {
+                        match(records[2 * i], records[2 * i + 1]);
+                    }
+                }
+                catch (Exception e) {
+                    exception = e;
+                    return false;
+                }
+                return !cancellationToken.IsCancellationRequested;
+            };
+            long r;
+            fixed (char* ptr = path) {
+                fixed (char* ptr2 = value) {
+                    r = FileSearch.SearchFile(ptr, ptr2, value.Length, callback, IntPtr.Zero);
+                }
+            }
+            GC.KeepAlive(callback);
+            if (exception != null) {
+                ExceptionDispatchInfo.Capture(exception).Throw();
+            }
+            return r;
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe long SearchFile(char* path, char* str, int n, Callback callback, IntPtr state);
+    }
+}
@@ -0,0 +1,118 @@
+﻿// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Indexes the line starts of a text for random line access.
+//
+// Lines end with LF, CR or CRLF. The index is built natively with a
+// vectorized scan, in parallel for large texts, and updated after an edit
+// by rescanning the edited range only. Start is O(1) and Find is a binary
+// search. See Circus.Core/text/line_index.h for details.
+//
+// The object holds native memory and must be disposed.
+
+
+#pragma warning disable IDE0002
+
+using System;
+using System.Runtime.InteropServices;
+using System.Security;
+namespace Circus.Text {
+    /// <summary>Provides an index of the line starts of a text.</summary>
+    public sealed class LineIndex : IDisposable {
+        private IntPtr handle;
+        public int Count => LineIndex.LineIndexCount(this.handle);
+        /// <summary>Constructs the index of the specified text.</summary>
+        [SecuritySafeCritical]
+        public unsafe LineIndex(string text) {
+            fixed (char* ptr = text) {
+                this.handle = LineIndex.CreateLineIndex(ptr, text.Length);
+            }
+        }
+        private LineIndex(IntPtr handle) {
+            this.handle = handle;
+        }
+        ~LineIndex() {
+            this.Dispose(false);
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe IntPtr CreateFileLineIndex(char* path);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe IntPtr CreateLineIndex(char* str, int n);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void DestroyLineIndex(IntPtr index);
+        public void Dispose() {
+            this.Dispose(true);
+        }
+        [SecuritySafeCritical]
+        private void Dispose(bool disposing) {
+            if (this.handle != IntPtr.Zero) {
+                LineIndex.DestroyLineIndex(this.handle);
+                this.handle = IntPtr.Zero;
+            }
+            if (disposing) {
+                GC.SuppressFinalize(this);
+            }
+        }
+        /// <summary>Returns the 0-based line that contains the specified offset.</summary>
+        [SecuritySafeCritical]
+        public int Find(long offset) {
+            return LineIndex.LineIndexFind(this.handle, offset);
+        }
+        /// <summary>Returns the index of the file at the specified path, without loading it in memory, or null if the file cannot be read or exceeds 4 GB. Offsets are in bytes, for UTF-16 files with a byte order mark as well, so the index cannot be updated.</summary>
+        [SecuritySafeCritical]
+        public static unsafe LineIndex FromFile(string path) {
+            IntPtr handle;
+            fixed (char* ptr = path) {
+                handle = LineIndex.CreateFileLineIndex(ptr);
+            }
+            return handle != IntPtr.Zero ? new LineIndex(handle) : null;
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int LineIndexCount(IntPtr index);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int LineIndexFind(IntPtr index, long offset);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern long LineIndexStart(IntPtr index, int line);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe bool LineIndexUpdate(IntPtr index, char* str, int n, int pos, int removed, int inserted);
+        /// <summary>Returns the offset of the first char of the specified line, or -1 if the line does not exist.</summary>
+        [SecuritySafeCritical]
+        public long Start(int line) {
+            return LineIndex.LineIndexStart(this.handle, line);
+        }
+        /// <summary>Updates the index after the specified number of chars at position were replaced with inserted chars, where text is the edited text. Returns false if the range is not in the indexed text, if text is not the indexed text with the range replaced, or if the index was returned by FromFile.</summary>
+        [SecuritySafeCritical]
+        public unsafe bool Update(string text, int position, int removed, int inserted) {
+            fixed (char* ptr = text) {
+                return LineIndex.LineIndexUpdate(this.handle, ptr, text.Length, position, removed, inserted);
+            }
+        }
+    }
+}
@@ -0,0 +1,146 @@
+﻿// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// An index of strings keyed by id for substring queries, i.e. filtering a
+// collection as the user types.
+//
+// Strings are indexed natively by trigram, and a query only verifies the
+// strings that hold all of its trigrams. Strings can be added and removed
+// to follow a collection. Ids are reported in insertion order. See
+// Circus.Core/text/ngram_index.h for details.
+//
+// The object holds native memory and must be disposed.
+
+
+#pragma warning disable IDE0002
+
+using System;
+using System.Runtime.InteropServices;
+using System.Security;
+namespace Circus.Text {
+    /// <summary>Provides an index of strings keyed by id for substring queries.</summary>
+    public sealed class NgramIndex : IDisposable {
+        private IntPtr handle;
+        public int Count => NgramIndex.NgramIndexCount(this.handle);
+        /// <summary>Constructs an empty index.</summary>
+        public NgramIndex() : this(false) {
+        }
+        /// <summary>Constructs an empty index that ignores case if specified.</summary>
+        [SecuritySafeCritical]
+        public NgramIndex(bool ignoreCase) {
+            this.handle = NgramIndex.CreateNgramIndex(ignoreCase);
+        }
+        ~NgramIndex() {
+            this.Dispose(false);
+        }
+        /// <summary>Adds the specified string with id, or replaces the string of id. Returns true if id was added.</summary>
+        [SecuritySafeCritical]
+        public unsafe bool Add(long id, string value) {
+            fixed (char* ptr = value) {
+                return NgramIndex.NgramIndexAdd(this.handle, id, ptr, value?.Length ?? 0);
+            }
+        }
+        /// <summary>Adds the specified strings with their ids in a single call.</summary>
+        [SecuritySafeCritical]
+        public unsafe void AddRange(long[] ids, string[] values) {
+            if (ids.Length != values.Length) {
+                throw new ArgumentException("Ids and values must have the same length.", nameof(values));
+            }
+            char[] str = StringInfo.Join(values, out int[] offsets);
+            fixed (long* ptr = ids) {
+                fixed (char* ptr2 = str) {
+                    fixed (int* ptr3 = offsets) {
+                        NgramIndex.NgramIndexAddBatch(this.handle, ptr, ptr2, ptr3, values.Length);
+                    }
+                }
+            }
+        }
+        [SecuritySafeCritical]
+        public void Clear() {
+            NgramIndex.NgramIndexClear(this.handle);
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr CreateNgramIndex(bool fold);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void DestroyNgramIndex(IntPtr index);
+        public void Dispose() {
+            this.Dispose(true);
+        }
+        [SecuritySafeCritical]
+        private void Dispose(bool disposing) {
+            if (this.handle != IntPtr.Zero) {
+                NgramIndex.DestroyNgramIndex(this.handle);
+                this.handle = IntPtr.Zero;
+            }
+            if (disposing) {
+                GC.SuppressFinalize(this);
+            }
+        }
+        /// <summary>Returns the ids of the strings that contain the specified value, in insertion order.</summary>
+        public long[] Find(string value) {
+            long[] ids = new long[16];
+            int n = this.Find(value, ids);
+            if (n > ids.Length) {
+                ids = new long[n];
+                n = this.Find(value, ids);
+            }
+            Array.Resize(ref ids, n);
+            return ids;
+        }
+        /// <summary>Finds the strings that contain the specified value. Their ids are written in insertion order, up to the length of ids. Returns the total number of strings, which can exceed the buffer.</summary>
+        [SecuritySafeCritical]
+        public unsafe int Find(string value, long[] ids) {
+            fixed (char* ptr = value) {
+                fixed (long* ptr2 = ids) {
+                    return NgramIndex.NgramIndexFind(this.handle, ptr, value.Length, ptr2, ids.Length);
+                }
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe bool NgramIndexAdd(IntPtr index, long id, char* str, int n);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe void NgramIndexAddBatch(IntPtr index, long* ids, char* str, int* offsets, int count);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void NgramIndexClear(IntPtr index);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int NgramIndexCount(IntPtr index);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int NgramIndexFind(IntPtr index, char* str, int n, long* ids, int cap);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern bool NgramIndexRemove(IntPtr index, long id);
+        /// <summary>Removes the string of the specified id. Returns true if removal succeded.</summary>
+        [SecuritySafeCritical]
+        public bool Remove(long id) {
+            return NgramIndex.NgramIndexRemove(this.handle, id);
+        }
+    }
+}
@@ -21,20 +21,28 @@
 // GetHashCode() returns the .net hash code as an integer since it is part
 // of the IEqualityComparer interface. Use StringInfo.GetHash() instead if 
 // Farmhash is preferred.
+//
+// When case is ignored, both equality and hash codes use the simple case
+// folding of Circus.Core, so the comparer can be provided to Map and Set.
 
 
 using System.Collections.Generic;
 namespace Circus.Text {
     /// <summary>Provides a string comparer that uses a Boyer-Moore algorythm for equality.</summary>
     public sealed class StringComparer : IEqualityComparer<string> {
+        private readonly bool ignoreCase;
         /// <summary>Constructs a string comprarer.</summary>
         public StringComparer() { 
         }
+        /// <summary>Constructs a string comparer that ignores case if specified.</summary>
+        public StringComparer(bool ignoreCase) {
+            this.ignoreCase = ignoreCase;
+        }
         bool IEqualityComparer<string>.Equals(string x, string y) {
-            return StringInfo.Equals(x, y);
+            return this.ignoreCase ? StringInfo.Equals(x, y, true) : StringInfo.Equals(x, y);
         }
         int IEqualityComparer<string>.GetHashCode(string obj) {
-            return obj.GetHashCode();
+            return this.ignoreCase ? (int)StringInfo.GetHash(obj, true) : obj.GetHashCode();
         }
     }
 }
\ No newline at end of file
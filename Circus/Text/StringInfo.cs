@@ -19,12 +19,22 @@
 
 #pragma warning disable IDE0002
 
+using System;
 using System.Runtime.InteropServices;
 using System.Security;
 using Circus.Runtime;
 namespace Circus.Text {
     /// <summary>Provides fast and efficient functionalities for strings.</summary>
     public sealed class StringInfo {
+        private enum HashMode {
+            Default,
+            Seeded,
+            Local
+        }
+        /// <summary>Gets the name of the kernel selected by Circus.Core to hash strings on this processor (SSE2, SSSE3 or AVX2). Kernels produce the same hash codes.</summary>
+        public static string HashKernel => StringInfo.GetHashKernel() == 2 ? "AVX2" : StringInfo.GetHashKernel() == 1 ? "SSSE3" : "SSE2";
+        /// <summary>Gets the random hash seed drawn for the process when Circus.Core is loaded.</summary>
+        public static readonly ulong Seed = StringInfo.HashSeed();
         private StringInfo() { 
         }
         /// <summary>Determines if the provided source string contains the specified value string. Outputs the index of the first occurrence. Returns true if found.</summary>
@@ -36,6 +46,39 @@ namespace Circus.Text {
                 }
             }
         }
+        /// <summary>Determines if the provided source string contains the specified value string, ignoring case if specified. Outputs the index of the first occurrence. Returns true if found.</summary>
+        [SecuritySafeCritical]
+        public static unsafe bool Contains(string source, string value, bool ignoreCase, out int index) {
+            if (!ignoreCase) {
+                return StringInfo.Contains(source, value, out index);
+            }
+            fixed (char* ptr = source) {
+                fixed (char* ptr2 = value) {
+                    return Allocator.Assign(StringInfo.ContainsIgnoreCase(ptr, source.Length, ptr2, value.Length), out index) && index > -1;
+                }
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int ContainsIgnoreCase(char* str, int n, char* str1, int n1);
+        /// <summary>Returns the Levenshtein distance between the provided x and y strings, ignoring case if specified.</summary>
+        public static int Distance(string x, string y, bool ignoreCase) {
+            return StringInfo.Distance(x, y, -1, ignoreCase);
+        }
+        /// <summary>Returns the Levenshtein distance between the provided x and y strings, ignoring case if specified, or -1 if it is greater than max. Stops as soon as the distance cannot be max or less.</summary>
+        [SecuritySafeCritical]
+        public static unsafe int Distance(string x, string y, int max, bool ignoreCase) {
+            fixed (char* ptr = x) {
+                fixed (char* ptr2 = y) {
+                    return StringInfo.EditDistance(ptr, x.Length, ptr2, y.Length, max, ignoreCase);
+                }
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int EditDistance(char* str, int n, char* str1, int n1, int k, bool fold);
         /// <summary>Determines if the provided x and y strings are equal.</summary>
         [SecuritySafeCritical]
         public static unsafe bool Equals(string x, string y) {
@@ -45,6 +88,18 @@ namespace Circus.Text {
                 }
             }
         }
+        /// <summary>Determines if the provided x and y strings are equal, ignoring case if specified.</summary>
+        [SecuritySafeCritical]
+        public static unsafe bool Equals(string x, string y, bool ignoreCase) {
+            if (!ignoreCase) {
+                return StringInfo.Equals(x, y);
+            }
+            fixed (char* ptr = x) {
+                fixed (char* ptr2 = y) {
+                    return StringInfo.EqualsIgnoreCase(ptr, x.Length, ptr2, y.Length);
+                }
+            }
+        }
         [SecurityCritical]
         [SuppressUnmanagedCodeSecurity]
         [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
@@ -52,7 +107,31 @@ namespace Circus.Text {
         [SecurityCritical]
         [SuppressUnmanagedCodeSecurity]
         [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe bool EqualsIgnoreCase(char* str, int n, char* str1, int n1);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
         private static extern unsafe int Contains(char* str, int n, char* str1, int n1);
+        /// <summary>Returns the indices of all the occurrences of the specified value string in the provided source string in a single call, ignoring case if specified. Overlapping occurrences are included if specified.</summary>
+        [SecuritySafeCritical]
+        public static unsafe int[] FindAll(string source, string value, bool ignoreCase, bool overlapping) {
+            int[] indices = new int[16];
+            fixed (char* ptr = source) {
+                fixed (char* ptr2 = value) {
+                    int n = StringInfo.FindAll(ptr, source.Length, ptr2, value.Length, ignoreCase, overlapping, indices, indices.Length);
+                    if (n > indices.Length) {
+                        indices = new int[n];
+                        StringInfo.FindAll(ptr, source.Length, ptr2, value.Length, ignoreCase, overlapping, indices, n);
+                    }
+                    Array.Resize(ref indices, n);
+                }
+            }
+            return indices;
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int FindAll(char* str, int n, char* str1, int n1, bool fold, bool overlapping, int[] offsets, int cap);
         /// <summary>Searches the provided source string for the first character that does not match any of the characters specified in value. Outputs the index of the first occurrence. Returns true if found.</summary>
         [SecuritySafeCritical]
         public static unsafe bool FirstNotOf(string source, string value, out int index) {
@@ -66,6 +145,60 @@ namespace Circus.Text {
         [SuppressUnmanagedCodeSecurity]
         [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
         private static extern unsafe int FirstNotOf(char* str, int n, char* str1, int n1);
+        /// <summary>Determines if the provided source string contains the specified value string with max typos at most, ignoring case if specified. Outputs the number of typos of the best occurrence. Returns true if found.</summary>
+        [SecuritySafeCritical]
+        public static unsafe bool FuzzyContains(string source, string value, int max, bool ignoreCase, out int distance) {
+            fixed (char* ptr = source) {
+                fixed (char* ptr2 = value) {
+                    return Allocator.Assign(StringInfo.FuzzySearch(ptr, source.Length, ptr2, value.Length, max, ignoreCase), out distance) && distance > -1;
+                }
+            }
+        }
+        /// <summary>Returns the indices of the top values that contain the provided query with max typos at most, ignoring case if specified, in a single call. Values are ranked by typos, then by FuzzyScore, then by index. Outputs the number of typos of each value returned.</summary>
+        [SecuritySafeCritical]
+        public static unsafe int[] FuzzyMatch(string[] values, string query, int max, int top, bool ignoreCase, out int[] distances) {
+            char[] blob = StringInfo.Join(values, out int[] offsets);
+            int[] indices = new int[Math.Min(top, values.Length)];
+            distances = new int[indices.Length];
+            int n;
+            fixed (char* ptr = blob) {
+                fixed (int* ptr2 = offsets) {
+                    fixed (char* ptr3 = query) {
+                        fixed (int* ptr4 = indices) {
+                            fixed (int* ptr5 = distances) {
+                                n = StringInfo.FuzzyMatch(ptr, ptr2, values.Length, ptr3, query.Length, max, ignoreCase, ptr4, ptr5, indices.Length);
+                            }
+                        }
+                    }
+                }
+            }
+            if (n < indices.Length) {
+                Array.Resize(ref indices, n);
+                Array.Resize(ref distances, n);
+            }
+            return indices;
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int FuzzyMatch(char* str, int* offsets, int count, char* str1, int n1, int k, bool fold, int* indices, int* distances, int top);
+        /// <summary>Returns the score of the provided value string as a subsequence of the source string, ignoring case if specified, or -1 if its characters do not all appear in order. Matches at word starts and consecutive matches score higher, gaps lower.</summary>
+        [SecuritySafeCritical]
+        public static unsafe int FuzzyScore(string source, string value, bool ignoreCase) {
+            fixed (char* ptr = source) {
+                fixed (char* ptr2 = value) {
+                    return StringInfo.FuzzyScore(ptr, source.Length, ptr2, value.Length, ignoreCase);
+                }
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int FuzzyScore(char* str, int n, char* str1, int n1, bool fold);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int FuzzySearch(char* str, int n, char* str1, int n1, int k, bool fold);
         /// <summary>Returns the hash code of the specified string as an unsigned 64-bit integer using Google's Farmhash algorythm.</summary>
         [SecuritySafeCritical]
         public static unsafe ulong GetHash(string value) {
@@ -77,6 +210,117 @@ namespace Circus.Text {
         [SuppressUnmanagedCodeSecurity]
         [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl, EntryPoint = "Hash")]
         private static extern unsafe bool GetHash(char* str, int n, out ulong hash);
+        /// <summary>Returns the hash code of the specified string, ignoring case if specified. Strings that are equal ignoring case have the same hash code.</summary>
+        [SecuritySafeCritical]
+        public static unsafe ulong GetHash(string value, bool ignoreCase) {
+            if (!ignoreCase) {
+                return StringInfo.GetHash(value);
+            }
+            fixed (char* ptr = value) {
+                return StringInfo.HashIgnoreCase(ptr, value.Length, out ulong hash) ? hash : (ulong)value.GetHashCode();
+            }
+        }
+        /// <summary>Returns the hash code of the specified string as an unsigned 64-bit integer using Google's Farmhash algorythm seeded with the specified seed. Use Seed for the random seed of the process.</summary>
+        [SecuritySafeCritical]
+        public static unsafe ulong GetHash(string value, ulong seed) {
+            fixed (char* ptr = value) {
+                return StringInfo.GetHash(ptr, value.Length, seed, out ulong hash) ? hash : (ulong)value.GetHashCode();
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl, EntryPoint = "HashWithSeed")]
+        private static extern unsafe bool GetHash(char* str, int n, ulong seed, out ulong hash);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern ulong HashSeed();
+        /// <summary>Returns the hash code of the specified string for tables local to the process using the XXH3 algorythm seeded with Seed. Hash codes differ between processes and releases and must not be persisted.</summary>
+        [SecuritySafeCritical]
+        public static unsafe ulong GetLocalHash(string value) {
+            fixed (char* ptr = value) {
+                return StringInfo.GetLocalHash(ptr, value.Length, out ulong hash) ? hash : (ulong)value.GetHashCode();
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl, EntryPoint = "HashLocal")]
+        private static extern unsafe bool GetLocalHash(char* str, int n, out ulong hash);
+        /// <summary>Returns the local hash codes of the specified strings in a single call. Values are the same as the ones returned by GetLocalHash(string). Null strings hash as empty.</summary>
+        [SecuritySafeCritical]
+        public static unsafe ulong[] GetLocalHash(string[] values) {
+            return StringInfo.GetHash(values, 0, HashMode.Local);
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl, EntryPoint = "HashKernel")]
+        private static extern int GetHashKernel();
+        /// <summary>Returns the hash codes of the specified strings in a single call. Values are the same as the ones returned by GetHash(string). Null strings hash as empty.</summary>
+        [SecuritySafeCritical]
+        public static unsafe ulong[] GetHash(string[] values) {
+            return StringInfo.GetHash(values, 0, HashMode.Default);
+        }
+        /// <summary>Returns the hash codes of the specified strings seeded with the specified seed in a single call. Values are the same as the ones returned by GetHash(string, ulong). Null strings hash as empty.</summary>
+        [SecuritySafeCritical]
+        public static unsafe ulong[] GetHash(string[] values, ulong seed) {
+            return StringInfo.GetHash(values, seed, HashMode.Seeded);
+        }
+        [SecuritySafeCritical]
+        private static unsafe ulong[] GetHash(string[] values, ulong seed, HashMode mode) {
+            char[] blob = StringInfo.Join(values, out int[] offsets);
+            ulong[] hashes = new ulong[values.Length];
+            fixed (char* ptr = blob) {
+                fixed (int* ptr2 = offsets) {
+                    fixed (ulong* ptr3 = hashes) {
+                        switch (mode) {
+                            case HashMode.Seeded:
+                                StringInfo.HashBatchWithSeed(ptr, ptr2, values.Length, seed, ptr3);
+                                break;
+                            case HashMode.Local:
+                                StringInfo.HashBatchLocal(ptr, ptr2, values.Length, ptr3);
+                                break;
+                            default:
+                                StringInfo.HashBatch(ptr, ptr2, values.Length, ptr3);
+                                break;
+                        }
+                    }
+                }
+            }
+            for (int i = 0; i < values.Length; i++) {
+                if ((values[i]?.Length ?? 0) == 0) {
+                    hashes[i] = (ulong)string.Empty.GetHashCode();
+                }
+            }
+            return hashes;
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe void HashBatch(char* str, int* offsets, int count, ulong* hashes);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe void HashBatchLocal(char* str, int* offsets, int count, ulong* hashes);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe void HashBatchWithSeed(char* str, int* offsets, int count, ulong seed, ulong* hashes);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe bool HashIgnoreCase(char* str, int n, out ulong hash);
+        /// <summary>Concatenates the specified strings into a single buffer for batch calls. Outputs the offset of each string plus the end of the buffer. Null strings are joined as empty.</summary>
+        internal static char[] Join(string[] values, out int[] offsets) {
+            offsets = new int[values.Length + 1];
+            for (int i = 0; i < values.Length; i++) {
+                offsets[i + 1] = checked(offsets[i] + (values[i]?.Length ?? 0));
+            }
+            char[] blob = new char[offsets[values.Length]];
+            for (int i = 0; i < values.Length; i++) {
+                values[i]?.CopyTo(0, blob, offsets[i], values[i].Length);
+            }
+            return blob;
+        }
         /// <summary>Determines if the provided source string contains the specified value string. Outputs the index of the last occurrence. Returns true if found.</summary>
         [SecuritySafeCritical]
         public static unsafe bool Last(string source, string value, out int index) {
@@ -103,5 +347,18 @@ namespace Circus.Text {
         [SuppressUnmanagedCodeSecurity]
         [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
         private static extern unsafe int LastNotOf(char* str, int n, char* str1, int n1);
+        /// <summary>Removes all leading and trailing characters of the provided source string that match any of the characters specified in value. Outputs the index and the length of the remaining string. Returns false if no character remains.</summary>
+        [SecuritySafeCritical]
+        public static unsafe bool Trim(string source, string value, out int index, out int length) {
+            fixed (char* ptr = source) {
+                fixed (char* ptr2 = value) {
+                    return StringInfo.Trim(ptr, source.Length, ptr2, value.Length, out index, out length);
+                }
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe bool Trim(char* str, int n, char* str1, int n1, out int index, out int length);
     }
 }
@@ -0,0 +1,88 @@
+﻿// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Finds many value strings in a single pass over a source string.
+//
+// Values are compiled once into a native Aho-Corasick automaton. Matches
+// are written as (value index, offset) pairs into a caller buffer so that
+// searching does not allocate. See Circus.Core/text/aho_corasick.h for
+// details.
+//
+// The object holds native memory and must be disposed.
+
+
+#pragma warning disable IDE0002
+
+using System;
+using System.Runtime.InteropServices;
+using System.Security;
+namespace Circus.Text {
+    /// <summary>Provides a compiled set of value strings to find in a single pass.</summary>
+    public sealed class StringMatcher : IDisposable {
+        private IntPtr handle;
+        /// <summary>Constructs a matcher for the specified value strings. Empty values are ignored.</summary>
+        [SecuritySafeCritical]
+        public unsafe StringMatcher(params string[] values) {
+            int[] offsets = new int[values.Length + 1];
+            for (int i = 0; i < values.Length; i++) {
+                offsets[i + 1] = offsets[i] + values[i].Length;
+            }
+            string str = string.Concat(values);
+            fixed (char* ptr = str) {
+                fixed (int* ptr2 = offsets) {
+                    this.handle = StringMatcher.CreateMatcher(ptr, ptr2, values.Length);
+                }
+            }
+        }
+        ~StringMatcher() {
+            this.Dispose(false);
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe IntPtr CreateMatcher(char* str, int* offsets, int count);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void DestroyMatcher(IntPtr matcher);
+        public void Dispose() {
+            this.Dispose(true);
+        }
+        [SecuritySafeCritical]
+        private void Dispose(bool disposing) {
+            if (this.handle != IntPtr.Zero) {
+                StringMatcher.DestroyMatcher(this.handle);
+                this.handle = IntPtr.Zero;
+            }
+            if (disposing) {
+                GC.SuppressFinalize(this);
+            }
+        }
+        /// <summary>Finds all occurrences of the values in the provided source string. Matches are written as (value index, offset) pairs in text order, up to half the length of matches. Returns the total number of matches, which can exceed the buffer.</summary>
+        [SecuritySafeCritical]
+        public unsafe int Match(string source, int[] matches) {
+            fixed (char* ptr = source) {
+                fixed (int* ptr2 = matches) {
+                    return StringMatcher.MatchAll(this.handle, ptr, source.Length, ptr2, matches.Length / 2);
+                }
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int MatchAll(IntPtr matcher, char* str, int n, int* matches, int cap);
+    }
+}
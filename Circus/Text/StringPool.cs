@@ -0,0 +1,134 @@
+﻿// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// A native pool of distinct strings with stable int ids.
+//
+// Each distinct string is copied and hashed once. Its id then gives its
+// cached hash, which is the one Map uses for string keys, its length and
+// its chars in O(1), and interned strings are equal if their ids are.
+// Finding a string is lock-free and interning can run from any thread.
+// See Circus.Core/text/intern_pool.h for details.
+//
+// The object holds native memory and must be disposed.
+
+
+#pragma warning disable IDE0002
+
+using System;
+using System.Runtime.InteropServices;
+using System.Security;
+namespace Circus.Text {
+    /// <summary>Provides a pool of distinct strings with stable ids and cached hashes.</summary>
+    public sealed class StringPool : IDisposable {
+        private IntPtr handle;
+        public int Count => StringPool.InternPoolCount(this.handle);
+        /// <summary>Constructs an empty pool.</summary>
+        [SecuritySafeCritical]
+        public StringPool() {
+            this.handle = StringPool.CreateInternPool();
+        }
+        ~StringPool() {
+            this.Dispose(false);
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern IntPtr CreateInternPool();
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void DestroyInternPool(IntPtr pool);
+        public void Dispose() {
+            this.Dispose(true);
+        }
+        [SecuritySafeCritical]
+        private void Dispose(bool disposing) {
+            if (this.handle != IntPtr.Zero) {
+                StringPool.DestroyInternPool(this.handle);
+                this.handle = IntPtr.Zero;
+            }
+            if (disposing) {
+                GC.SuppressFinalize(this);
+            }
+        }
+        /// <summary>Returns the id of the specified string, or -1 if it is not interned.</summary>
+        [SecuritySafeCritical]
+        public unsafe int Find(string value) {
+            fixed (char* ptr = value) {
+                return StringPool.InternPoolFind(this.handle, ptr, value.Length);
+            }
+        }
+        /// <summary>Returns the cached hash of the string of the specified id.</summary>
+        [SecuritySafeCritical]
+        public unsafe ulong GetHash(int id) {
+            return StringPool.InternPoolGet(this.handle, id, out _, out _, out ulong hash) ? hash : throw new ArgumentOutOfRangeException(nameof(id));
+        }
+        /// <summary>Returns the length of the string of the specified id.</summary>
+        [SecuritySafeCritical]
+        public unsafe int GetLength(int id) {
+            return StringPool.InternPoolGet(this.handle, id, out _, out int n, out _) ? n : throw new ArgumentOutOfRangeException(nameof(id));
+        }
+        /// <summary>Returns the string of the specified id.</summary>
+        [SecuritySafeCritical]
+        public unsafe string GetString(int id) {
+            return StringPool.InternPoolGet(this.handle, id, out char* ptr, out int n, out _) ? new string(ptr, 0, n) : throw new ArgumentOutOfRangeException(nameof(id));
+        }
+        /// <summary>Returns the id of the specified string, interning it first if needed.</summary>
+        [SecuritySafeCritical]
+        public unsafe int Intern(string value) {
+            fixed (char* ptr = value) {
+                int id = StringPool.Intern(this.handle, ptr, value.Length);
+                return id > -1 ? id : throw new OutOfMemoryException();
+            }
+        }
+        /// <summary>Returns the ids of the specified strings, interning them first if needed, in a single call.</summary>
+        [SecuritySafeCritical]
+        public unsafe int[] Intern(string[] values) {
+            char[] str = StringInfo.Join(values, out int[] offsets);
+            int[] ids = new int[values.Length];
+            fixed (char* ptr = str) {
+                fixed (int* ptr2 = offsets) {
+                    fixed (int* ptr3 = ids) {
+                        if (!StringPool.InternBatch(this.handle, ptr, ptr2, values.Length, ptr3)) {
+                            throw new OutOfMemoryException();
+                        }
+                    }
+                }
+            }
+            return ids;
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int Intern(IntPtr pool, char* str, int n);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe bool InternBatch(IntPtr pool, char* str, int* offsets, int count, int* ids);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern int InternPoolCount(IntPtr pool);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int InternPoolFind(IntPtr pool, char* str, int n);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe bool InternPoolGet(IntPtr pool, int id, out char* str, out int n, out ulong hash);
+    }
+}
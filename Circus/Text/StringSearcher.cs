@@ -0,0 +1,83 @@
+﻿// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// A precompiled value string to search in many strings.
+//
+// The value is copied and prepared once in native memory, which avoids
+// rebuilding it for each source string when filtering a collection. See
+// Circus.Core/text/searcher.h for details.
+//
+// The object holds native memory and must be disposed.
+
+
+#pragma warning disable IDE0002
+
+using System;
+using System.Runtime.InteropServices;
+using System.Security;
+using Circus.Runtime;
+namespace Circus.Text {
+    /// <summary>Provides a precompiled value string to search in many strings.</summary>
+    public sealed class StringSearcher : IDisposable {
+        private IntPtr handle;
+        /// <summary>Constructs a searcher for the specified value string.</summary>
+        [SecuritySafeCritical]
+        public unsafe StringSearcher(string value) {
+            fixed (char* ptr = value) {
+                this.handle = StringSearcher.CreateSearcher(ptr, value.Length);
+            }
+        }
+        ~StringSearcher() {
+            this.Dispose(false);
+        }
+        /// <summary>Determines if the provided source string contains the value string. Outputs the index of the first occurrence. Returns true if found.</summary>
+        public bool Contains(string source, out int index) {
+            return this.Contains(source, false, out index);
+        }
+        /// <summary>Determines if the provided source string contains the value string, optionally ignoring case. Outputs the index of the first occurrence. Returns true if found.</summary>
+        [SecuritySafeCritical]
+        public unsafe bool Contains(string source, bool ignoreCase, out int index) {
+            fixed (char* ptr = source) {
+                return Allocator.Assign(StringSearcher.SearchWith(this.handle, ptr, source.Length, ignoreCase), out index) && index > -1;
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe IntPtr CreateSearcher(char* str, int n);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void DestroySearcher(IntPtr searcher);
+        public void Dispose() {
+            this.Dispose(true);
+        }
+        [SecuritySafeCritical]
+        private void Dispose(bool disposing) {
+            if (this.handle != IntPtr.Zero) {
+                StringSearcher.DestroySearcher(this.handle);
+                this.handle = IntPtr.Zero;
+            }
+            if (disposing) {
+                GC.SuppressFinalize(this);
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int SearchWith(IntPtr searcher, char* str, int n, bool fold);
+    }
+}
@@ -0,0 +1,126 @@
+﻿// Copyright (c) 2019-2020, Circus.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+//
+// You may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+//
+// Splits strings into tokens at a set of delimiter chars.
+//
+// The delimiters, trimmed chars, quote and escape chars are compiled once
+// into a native tokenizer. Tokens are written as (start, length) pairs
+// into a caller buffer so that splitting does not allocate. Text can be
+// split in chunks by feeding it again from the consumed position. See
+// Circus.Core/text/tokenizer.h for details.
+//
+// The object holds native memory and must be disposed.
+
+
+#pragma warning disable IDE0002
+
+using System;
+using System.Collections.Generic;
+using System.Runtime.InteropServices;
+using System.Security;
+namespace Circus.Text {
+    /// <summary>Provides a compiled set of delimiter chars to split strings into tokens.</summary>
+    public sealed class StringTokenizer : IDisposable {
+        private IntPtr handle;
+        /// <summary>Constructs a tokenizer for the specified delimiter chars.</summary>
+        public StringTokenizer(string delimiters) : this(delimiters, null, '\0', '\0') {
+        }
+        /// <summary>Constructs a tokenizer for the specified delimiter chars, chars trimmed from tokens, and quote and escape chars. A zero quote or escape char is ignored. An escape char equal to the quote char escapes quotes by doubling them.</summary>
+        [SecuritySafeCritical]
+        public unsafe StringTokenizer(string delimiters, string trim, char quote, char escape) {
+            trim = trim ?? string.Empty;
+            fixed (char* ptr = delimiters) {
+                fixed (char* ptr2 = trim) {
+                    this.handle = StringTokenizer.CreateTokenizer(ptr, delimiters.Length, ptr2, trim.Length, quote, escape);
+                }
+            }
+        }
+        ~StringTokenizer() {
+            this.Dispose(false);
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl, CharSet = CharSet.Unicode)]
+        private static extern unsafe IntPtr CreateTokenizer(char* str, int n, char* str1, int n1, char quote, char escape);
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern void DestroyTokenizer(IntPtr tokenizer);
+        public void Dispose() {
+            this.Dispose(true);
+        }
+        [SecuritySafeCritical]
+        private void Dispose(bool disposing) {
+            if (this.handle != IntPtr.Zero) {
+                StringTokenizer.DestroyTokenizer(this.handle);
+                this.handle = IntPtr.Zero;
+            }
+            if (disposing) {
+                GC.SuppressFinalize(this);
+            }
+        }
+        /// <summary>Splits the provided source string from the specified start index. Tokens are written as (start, length) pairs in text order, up to half the length of spans. Only tokens ended by a delimiter are written unless last is true. Outputs the index at which the next call must resume. Returns the number of tokens written.</summary>
+        [SecuritySafeCritical]
+        public unsafe int Next(string source, int start, bool last, int[] spans, out int consumed) {
+            if (start < 0 || start > source.Length) {
+                throw new ArgumentOutOfRangeException(nameof(start));
+            }
+            fixed (char* ptr = source) {
+                return StringTokenizer.Next(this.handle, ptr, start, source.Length - start, last, spans, out consumed);
+            }
+        }
+        /// <summary>Splits the specified range of the provided buffer. Tokens are written as (start, length) pairs of buffer indices in text order, up to half the length of spans. Only tokens ended by a delimiter are written unless last is true. Outputs the index at which the next call must resume. Returns the number of tokens written.</summary>
+        [SecuritySafeCritical]
+        public unsafe int Next(char[] buffer, int start, int length, bool last, int[] spans, out int consumed) {
+            if (start < 0 || start > buffer.Length) {
+                throw new ArgumentOutOfRangeException(nameof(start));
+            }
+            if (length < 0 || length > buffer.Length - start) {
+                throw new ArgumentOutOfRangeException(nameof(length));
+            }
+            fixed (char* ptr = buffer) {
+                return StringTokenizer.Next(this.handle, ptr, start, length, last, spans, out consumed);
+            }
+        }
+        [SecurityCritical]
+        private static unsafe int Next(IntPtr tokenizer, char* ptr, int start, int length, bool last, int[] spans, out int consumed) {
+            int count;
+            fixed (int* ptr2 = spans) {
+                count = StringTokenizer.Tokenize(tokenizer, ptr + start, length, last, ptr2, spans.Length / 2, out consumed);
+            }
+            for (int i = 0; i < count; i++) {
+                spans[2 * i] += start;
+            }
+            consumed += start;
+            return count;
+        }
+        /// <summary>Returns the tokens of the provided source string.</summary>
+        public IEnumerable<string> Split(string source) {
+            int[] spans = new int[512];
+            int start = 0;
+            while (start < source.Length) {
+                int count = this.Next(source, start, true, spans, out start);
+                for (int i = 0; i < count; i++) {
+                    yield return source.Substring(spans[2 * i], spans[2 * i + 1]);
+                }
+            }
+        }
+        [SecurityCritical]
+        [SuppressUnmanagedCodeSecurity]
+        [DllImport("Circus.Core.dll", CallingConvention = CallingConvention.Cdecl)]
+        private static extern unsafe int Tokenize(IntPtr tokenizer, char* str, int n, bool last, int* spans, int cap, out int consumed);
+    }
+}